@@ -0,0 +1,6 @@
+-- Script to migate from db version 28 to 29.
+-- Added binary flag to oplog, for ops stored in the compact OpCodec encoding
+
+ALTER TABLE oplog ADD COLUMN binary BOOLEAN NOT NULL DEFAULT 0;
+
+UPDATE settings SET v = '29' WHERE k == 'schema_version';
@@ -0,0 +1,11 @@
+-- Script to migate from db version 29 to 30.
+-- Added oplog_snapshot, holding our compacted file history
+
+CREATE TABLE IF NOT EXISTS oplog_snapshot (
+    cutoff INTEGER NOT NULL,
+    guid TEXT NOT NULL,
+    compressed BOOLEAN NOT NULL,
+    json TEXT NOT NULL
+);
+
+UPDATE settings SET v = '30' WHERE k == 'schema_version';
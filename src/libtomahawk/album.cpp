@@ -25,13 +25,19 @@
 #include "database/databasecommand_alltracks.h"
 #include "query.h"
 
+#include "utils/interner.h"
 #include "utils/logger.h"
 
 using namespace Tomahawk;
 
+static TomahawkUtils::WeakInternHash< unsigned int, Album >* s_albums = new TomahawkUtils::WeakInternHash< unsigned int, Album >();
+
 
 Album::~Album()
 {
+    if ( m_id > 0 )
+        s_albums->removeExpired( m_id );
+
     delete m_cover;
 }
 
@@ -50,18 +56,16 @@ Album::get( const Tomahawk::artist_ptr& artist, const QString& name, bool autoCr
 album_ptr
 Album::get( unsigned int id, const QString& name, const Tomahawk::artist_ptr& artist )
 {
-    static QHash< unsigned int, album_ptr > s_albums;
-    static QMutex s_mutex;
-
-    QMutexLocker lock( &s_mutex );
-    if ( s_albums.contains( id ) )
+    if ( id > 0 )
     {
-        return s_albums.value( id );
+        album_ptr a = s_albums->value( id );
+        if ( !a.isNull() )
+            return a;
     }
 
     album_ptr a = album_ptr( new Album( id, name, artist ) );
     if ( id > 0 )
-        s_albums.insert( id, a );
+        return s_albums->insert( id, a ); // another thread may have beaten us to it
 
     return a;
 }
@@ -70,7 +74,7 @@ Album::get( unsigned int id, const QString& name, const Tomahawk::artist_ptr& ar
 Album::Album( unsigned int id, const QString& name, const Tomahawk::artist_ptr& artist )
     : QObject()
     , m_id( id )
-    , m_name( name )
+    , m_name( TomahawkUtils::internString( name ) )
     , m_artist( artist )
     , m_cover( 0 )
     , m_infoLoaded( false )
@@ -24,13 +24,20 @@
 #include "database/databaseimpl.h"
 #include "query.h"
 
+#include "utils/interner.h"
 #include "utils/logger.h"
 
 using namespace Tomahawk;
 
+// never freed, objects may still be around while static data gets destroyed on exit
+static TomahawkUtils::WeakInternHash< unsigned int, Artist >* s_artists = new TomahawkUtils::WeakInternHash< unsigned int, Artist >();
+
 
 Artist::~Artist()
 {
+    if ( m_id > 0 )
+        s_artists->removeExpired( m_id );
+
     delete m_cover;
 }
 
@@ -49,18 +56,16 @@ Artist::get( const QString& name, bool autoCreate )
 artist_ptr
 Artist::get( unsigned int id, const QString& name )
 {
-    static QHash< unsigned int, artist_ptr > s_artists;
-    static QMutex s_mutex;
-
-    QMutexLocker lock( &s_mutex );
-    if ( s_artists.contains( id ) )
+    if ( id > 0 )
     {
-        return s_artists.value( id );
+        artist_ptr a = s_artists->value( id );
+        if ( !a.isNull() )
+            return a;
     }
 
     artist_ptr a = artist_ptr( new Artist( id, name ) );
     if ( id > 0 )
-        s_artists.insert( id, a );
+        return s_artists->insert( id, a ); // another thread may have beaten us to it
 
     return a;
 }
@@ -69,11 +74,11 @@ Artist::get( unsigned int id, const QString& name )
 Artist::Artist( unsigned int id, const QString& name )
     : QObject()
     , m_id( id )
-    , m_name( name )
+    , m_name( TomahawkUtils::internString( name ) )
     , m_cover( 0 )
     , m_infoLoaded( false )
 {
-    m_sortname = DatabaseImpl::sortname( name, true );
+    m_sortname = TomahawkUtils::internString( DatabaseImpl::sortname( name, true ) );
 
     connect( Tomahawk::InfoSystem::InfoSystem::instance(),
              SIGNAL( info( Tomahawk::InfoSystem::InfoRequestData, QVariant ) ),
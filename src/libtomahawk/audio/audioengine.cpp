@@ -29,11 +29,13 @@
 #include "database/database.h"
 #include "database/databasecommand_logplayback.h"
 #include "network/servent.h"
+#include "network/streamcache.h"
 #include "utils/qnr_iodevicestream.h"
 #include "headlesscheck.h"
 #include "infosystem/infosystem.h"
 #include "album.h"
 
+#include "utils/tomahawkutils.h"
 #include "utils/logger.h"
 
 
@@ -73,6 +75,11 @@ AudioEngine::AudioEngine()
     connect( m_mediaObject, SIGNAL( stateChanged( Phonon::State, Phonon::State ) ), SLOT( onStateChanged( Phonon::State, Phonon::State ) ) );
     connect( m_mediaObject, SIGNAL( tick( qint64 ) ), SLOT( timerTriggered( qint64 ) ) );
     connect( m_mediaObject, SIGNAL( aboutToFinish() ), SLOT( onAboutToFinish() ) );
+    connect( m_mediaObject, SIGNAL( currentSourceChanged( Phonon::MediaSource ) ), SLOT( onCurrentSourceChanged( Phonon::MediaSource ) ) );
+
+    m_preloadTimer.setSingleShot( true );
+    m_preloadTimer.setInterval( AUDIO_PRELOAD_DELAY );
+    connect( &m_preloadTimer, SIGNAL( timeout() ), SLOT( preloadNextTrack() ) );
 
     connect( m_audioOutput, SIGNAL( volumeChanged( qreal ) ), SLOT( onVolumeChanged( qreal ) ) );
 
@@ -169,6 +176,9 @@ AudioEngine::stop()
         return;
 
     setState( Stopped );
+    m_preloadTimer.stop();
+    clearQueuedTrack();
+    clearPreloadedTrack();
     m_mediaObject->stop();
 
     if ( !m_playlist.isNull() )
@@ -219,6 +229,10 @@ AudioEngine::canGoNext()
 {
     tDebug( LOGVERBOSE ) << Q_FUNC_INFO;
 
+    // the playlist already moved on to the track waiting in phonon's queue
+    if ( !m_queuedTrack.isNull() )
+        return true;
+
     if ( m_queue && m_queue->trackCount() )
         return true;
 
@@ -380,23 +394,16 @@ AudioEngine::loadTrack( const Tomahawk::result_ptr& result )
     bool err = false;
     {
         QSharedPointer<QIODevice> io;
+        Phonon::MediaSource source;
+
+        clearQueuedTrack();
 
         if ( result.isNull() )
             err = true;
         else
         {
             setCurrentTrack( result );
-
-            if ( !isHttpResult( m_currentTrack->url() ) && !isLocalResult( m_currentTrack->url() ) )
-            {
-                io = Servent::instance()->getIODeviceForUrl( m_currentTrack );
-
-                if ( !io || io.isNull() )
-                {
-                    tLog() << "Error getting iodevice for" << result->url();
-                    err = true;
-                }
-            }
+            err = !openTrack( m_currentTrack, source, io );
         }
 
         if ( !err )
@@ -404,39 +411,7 @@ AudioEngine::loadTrack( const Tomahawk::result_ptr& result )
             tLog() << "Starting new song:" << m_currentTrack->url();
             emit loading( m_currentTrack );
 
-            if ( !isHttpResult( m_currentTrack->url() ) && !isLocalResult( m_currentTrack->url() ) )
-            {
-                if ( QNetworkReply* qnr_io = qobject_cast< QNetworkReply* >( io.data() ) )
-                    m_mediaObject->setCurrentSource( new QNR_IODeviceStream( qnr_io, this ) );
-                else
-                    m_mediaObject->setCurrentSource( io.data() );
-                m_mediaObject->currentSource().setAutoDelete( false );
-            }
-            else
-            {
-                if ( !isLocalResult( m_currentTrack->url() ) )
-                {
-                    QUrl furl = m_currentTrack->url();
-                    if ( m_currentTrack->url().contains( "?" ) )
-                    {
-                        furl = QUrl( m_currentTrack->url().left( m_currentTrack->url().indexOf( '?' ) ) );
-                        furl.setEncodedQuery( QString( m_currentTrack->url().mid( m_currentTrack->url().indexOf( '?' ) + 1 ) ).toLocal8Bit() );
-                    }
-                    m_mediaObject->setCurrentSource( furl );
-                }
-                else
-                {
-                    QString furl = m_currentTrack->url();
-#ifdef Q_WS_WIN
-                    if ( furl.startsWith( "file://" ) )
-                        furl = furl.right( furl.length() - 7 );
-#endif
-                    tLog( LOGVERBOSE ) << "Passing to Phonon:" << furl << furl.toLatin1();
-                    m_mediaObject->setCurrentSource( furl );
-                }
-
-                m_mediaObject->currentSource().setAutoDelete( true );
-            }
+            m_mediaObject->setCurrentSource( source );
 
             if ( !m_input.isNull() )
             {
@@ -445,26 +420,8 @@ AudioEngine::loadTrack( const Tomahawk::result_ptr& result )
             }
             m_input = io;
             m_mediaObject->play();
-            emit started( m_currentTrack );
-
-            if ( TomahawkSettings::instance()->verboseNotifications() )
-                sendNowPlayingNotification();
 
-            if ( TomahawkSettings::instance()->privateListeningMode() != TomahawkSettings::FullyPrivate )
-            {
-                DatabaseCommand_LogPlayback* cmd = new DatabaseCommand_LogPlayback( m_currentTrack, DatabaseCommand_LogPlayback::Started );
-                Database::instance()->enqueue( QSharedPointer<DatabaseCommand>(cmd) );
-
-                Tomahawk::InfoSystem::InfoStringHash trackInfo;
-                trackInfo["title"] = m_currentTrack->track();
-                trackInfo["artist"] = m_currentTrack->artist()->name();
-                trackInfo["album"] = m_currentTrack->album()->name();
-
-                Tomahawk::InfoSystem::InfoSystem::instance()->pushInfo(
-                    s_aeInfoIdentifier,
-                    Tomahawk::InfoSystem::InfoNowPlaying,
-                    QVariant::fromValue< Tomahawk::InfoSystem::InfoStringHash >( trackInfo ) );
-            }
+            trackStarted();
         }
     }
 
@@ -479,32 +436,199 @@ AudioEngine::loadTrack( const Tomahawk::result_ptr& result )
 }
 
 
+bool
+AudioEngine::openTrack( const Tomahawk::result_ptr& result, Phonon::MediaSource& source, QSharedPointer<QIODevice>& io )
+{
+    if ( !m_preloadedTrack.isNull() && m_preloadedTrack == result )
+    {
+        tDebug( LOGEXTRA ) << Q_FUNC_INFO << "Using preloaded stream for" << result->url();
+        io = m_preloadedInput;
+
+        m_preloadedTrack.clear();
+        m_preloadedInput.clear();
+    }
+    else
+    {
+        clearPreloadedTrack();
+
+        if ( !isLocalResult( result->url() ) && !openStream( result, io ) )
+        {
+            tLog() << "Error getting iodevice for" << result->url();
+            return false;
+        }
+    }
+
+    if ( !io.isNull() )
+    {
+        // network streams can't seek and need to tell phonon when they're really finished
+        if ( io->isSequential() )
+            source = Phonon::MediaSource( new QNR_IODeviceStream( io.data(), this ) );
+        else
+            source = Phonon::MediaSource( io.data() );
+        source.setAutoDelete( false );
+    }
+    else if ( isHttpResult( result->url() ) )
+    {
+        QUrl furl = TomahawkUtils::resolverUrl( result->url() );
+        tLog( LOGVERBOSE ) << "Passing to Phonon:" << furl;
+        source = Phonon::MediaSource( furl );
+        source.setAutoDelete( true );
+    }
+    else
+    {
+        QString furl = result->url();
+#ifdef Q_WS_WIN
+        if ( furl.startsWith( "file://" ) )
+            furl = furl.right( furl.length() - 7 );
+#endif
+        tLog( LOGVERBOSE ) << "Passing to Phonon:" << furl << furl.toLatin1();
+        source = Phonon::MediaSource( furl );
+        source.setAutoDelete( true );
+    }
+
+    return true;
+}
+
+
+bool
+AudioEngine::openStream( const Tomahawk::result_ptr& result, QSharedPointer<QIODevice>& io ) const
+{
+    // without a known size we can't buffer http streams seekably, so those
+    // are left to phonon: io stays null
+    if ( isHttpResult( result->url() ) )
+    {
+        if ( StreamCache::instance() )
+            io = StreamCache::instance()->cachedIODevice( StreamCache::key( result ) );
+        if ( io.isNull() && result->size() > 0 )
+            io = Servent::instance()->getIODeviceForUrl( result );
+        return true;
+    }
+
+    // this also takes care of serving and filling our stream cache
+    io = Servent::instance()->getIODeviceForUrl( result );
+    return !io.isNull();
+}
+
+
 void
-AudioEngine::loadPreviousTrack()
+AudioEngine::trackStarted()
 {
-    tDebug( LOGEXTRA ) << Q_FUNC_INFO;
+    emit started( m_currentTrack );
 
-    if ( m_playlist.isNull() )
+    if ( TomahawkSettings::instance()->verboseNotifications() )
+        sendNowPlayingNotification();
+
+    if ( TomahawkSettings::instance()->privateListeningMode() != TomahawkSettings::FullyPrivate )
     {
-        stop();
+        DatabaseCommand_LogPlayback* cmd = new DatabaseCommand_LogPlayback( m_currentTrack, DatabaseCommand_LogPlayback::Started );
+        Database::instance()->enqueue( QSharedPointer<DatabaseCommand>(cmd) );
+
+        Tomahawk::InfoSystem::InfoStringHash trackInfo;
+        trackInfo["title"] = m_currentTrack->track();
+        trackInfo["artist"] = m_currentTrack->artist()->name();
+        trackInfo["album"] = m_currentTrack->album()->name();
+
+        Tomahawk::InfoSystem::InfoSystem::instance()->pushInfo(
+            s_aeInfoIdentifier,
+            Tomahawk::InfoSystem::InfoNowPlaying,
+            QVariant::fromValue< Tomahawk::InfoSystem::InfoStringHash >( trackInfo ) );
+    }
+
+    // start buffering whatever comes next, so it's ready when we get there
+    m_preloadTimer.start();
+}
+
+
+void
+AudioEngine::preloadNextTrack()
+{
+    if ( isStopped() )
+        return;
+
+    Tomahawk::result_ptr result;
+    if ( m_queue && m_queue->trackCount() )
+        result = m_queue->peekNextItem();
+    else if ( !m_playlist.isNull() && canGoNext() )
+        result = m_playlist.data()->peekNextItem();
+
+    if ( result.isNull() || result == m_currentTrack || result == m_preloadedTrack || result == m_queuedTrack )
+        return;
+
+    clearPreloadedTrack();
+
+    // local files are instantly available anyway
+    if ( isLocalResult( result->url() ) )
+        return;
+
+    QSharedPointer<QIODevice> io;
+    if ( !openStream( result, io ) || io.isNull() )
+    {
+        tLog() << "Could not preload" << result->url();
         return;
     }
 
-    Tomahawk::result_ptr result = m_playlist.data()->previousItem();
-    if ( !result.isNull() )
-        loadTrack( result );
-    else
-        stop();
+    tDebug( LOGEXTRA ) << Q_FUNC_INFO << "Buffering next track:" << result->url();
+    m_preloadedTrack = result;
+    m_preloadedInput = io;
 }
 
 
 void
-AudioEngine::loadNextTrack()
+AudioEngine::clearPreloadedTrack()
 {
-    tDebug( LOGEXTRA ) << Q_FUNC_INFO;
+    if ( !m_preloadedInput.isNull() )
+    {
+        // closing the device also tears down the connection feeding it
+        m_preloadedInput->close();
+        m_preloadedInput.clear();
+    }
+
+    m_preloadedTrack.clear();
+}
+
+
+void
+AudioEngine::clearQueuedTrack()
+{
+    if ( m_queuedTrack.isNull() )
+        return;
+
+    m_mediaObject->clearQueue();
+
+    if ( !m_queuedInput.isNull() )
+    {
+        m_queuedInput->close();
+        m_queuedInput.clear();
+    }
+
+    m_queuedTrack.clear();
+    m_queuedTrackPlaylist.clear();
+}
 
+
+Tomahawk::result_ptr
+AudioEngine::takeNextTrack( Tomahawk::playlistinterface_ptr& playlist )
+{
     Tomahawk::result_ptr result;
 
+    if ( !m_queuedTrack.isNull() )
+    {
+        // we already advanced the playlist when handing this track to phonon
+        result = m_queuedTrack;
+        playlist = m_queuedTrackPlaylist;
+
+        if ( !m_queuedInput.isNull() )
+        {
+            clearPreloadedTrack();
+            m_preloadedTrack = m_queuedTrack;
+            m_preloadedInput = m_queuedInput;
+            m_queuedInput.clear();
+        }
+
+        clearQueuedTrack();
+        return result;
+    }
+
     if ( m_queue && m_queue->trackCount() )
     {
         result = m_queue->nextItem();
@@ -514,9 +638,41 @@ AudioEngine::loadNextTrack()
     {
         tDebug( LOGEXTRA ) << Q_FUNC_INFO << "Loading playlist's next item";
         result = m_playlist.data()->nextItem();
-        m_currentTrackPlaylist = m_playlist;
+        playlist = m_playlist;
+    }
+
+    return result;
+}
+
+
+void
+AudioEngine::loadPreviousTrack()
+{
+    tDebug( LOGEXTRA ) << Q_FUNC_INFO;
+
+    if ( m_playlist.isNull() )
+    {
+        stop();
+        return;
     }
 
+    Tomahawk::result_ptr result = m_playlist.data()->previousItem();
+    if ( !result.isNull() )
+        loadTrack( result );
+    else
+        stop();
+}
+
+
+void
+AudioEngine::loadNextTrack()
+{
+    tDebug( LOGEXTRA ) << Q_FUNC_INFO;
+
+    Tomahawk::playlistinterface_ptr playlist = m_currentTrackPlaylist;
+    Tomahawk::result_ptr result = takeNextTrack( playlist );
+    m_currentTrackPlaylist = playlist;
+
     if ( !result.isNull() )
     {
         tDebug( LOGEXTRA ) << Q_FUNC_INFO << "Got next item, loading track";
@@ -580,6 +736,69 @@ AudioEngine::onAboutToFinish()
 {
     tDebug( LOGVERBOSE ) << Q_FUNC_INFO;
     m_expectStop = true;
+
+    // playlists following someone else's playback decide on their own when to move on
+    if ( !m_queuedTrack.isNull() || !canGoNext() ||
+         ( !m_playlist.isNull() && ( m_playlist->latchMode() == PlaylistInterface::RealTime ||
+                                     m_playlist->retryMode() == PlaylistInterface::Retry ) ) )
+        return;
+
+    // hand the next track to phonon's queue now, so it can switch over without a gap
+    Tomahawk::playlistinterface_ptr playlist = m_currentTrackPlaylist;
+    Tomahawk::result_ptr result = takeNextTrack( playlist );
+    if ( result.isNull() )
+        return;
+
+    m_queuedTrack = result;
+    m_queuedTrackPlaylist = playlist;
+
+    Phonon::MediaSource source;
+    QSharedPointer<QIODevice> io;
+    if ( !openTrack( result, source, io ) )
+    {
+        // we'll try again regularly once the current track has stopped
+        return;
+    }
+
+    tDebug( LOGEXTRA ) << Q_FUNC_INFO << "Queueing next track:" << result->url();
+    m_queuedInput = io;
+    m_mediaObject->enqueue( source );
+}
+
+
+void
+AudioEngine::onCurrentSourceChanged( const Phonon::MediaSource& source )
+{
+    Q_UNUSED( source );
+
+    // only interesting when phonon moved on to the track we queued up
+    if ( m_queuedTrack.isNull() )
+        return;
+
+    tDebug( LOGEXTRA ) << Q_FUNC_INFO << "Gapless transition to" << m_queuedTrack->url();
+    m_expectStop = false;
+
+    Tomahawk::result_ptr result = m_queuedTrack;
+    QSharedPointer<QIODevice> io = m_queuedInput;
+    m_currentTrackPlaylist = m_queuedTrackPlaylist;
+
+    m_queuedTrack.clear();
+    m_queuedTrackPlaylist.clear();
+    m_queuedInput.clear();
+
+    setCurrentTrack( result );
+    tLog() << "Starting new song:" << m_currentTrack->url();
+    emit loading( m_currentTrack );
+
+    if ( !m_input.isNull() )
+    {
+        m_input->close();
+        m_input.clear();
+    }
+    m_input = io;
+
+    trackStarted();
+    m_waitingOnNewTrack = false;
 }
 
 
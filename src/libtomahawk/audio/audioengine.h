@@ -34,6 +34,9 @@
 
 #define AUDIO_VOLUME_STEP 5
 
+// time after a track started playing before we start buffering the next one
+#define AUDIO_PRELOAD_DELAY 5000
+
 
 class DLLEXPORT AudioEngine : public QObject
 {
@@ -121,6 +124,7 @@ private slots:
 
     void onAboutToFinish();
     void onStateChanged( Phonon::State newState, Phonon::State oldState );
+    void onCurrentSourceChanged( const Phonon::MediaSource& source );
     void onVolumeChanged( qreal volume ) { emit volumeChanged( volume * 100 ); }
     void timerTriggered( qint64 time );
 
@@ -130,9 +134,18 @@ private slots:
 
     void sendWaitingNotificationSlot() const;
 
+    void preloadNextTrack();
+
 private:
     void setState( AudioState state );
 
+    bool openTrack( const Tomahawk::result_ptr& result, Phonon::MediaSource& source, QSharedPointer<QIODevice>& io );
+    bool openStream( const Tomahawk::result_ptr& result, QSharedPointer<QIODevice>& io ) const;
+    void clearPreloadedTrack();
+    void clearQueuedTrack();
+    Tomahawk::result_ptr takeNextTrack( Tomahawk::playlistinterface_ptr& playlist );
+    void trackStarted();
+
     bool isHttpResult( const QString& ) const;
     bool isLocalResult( const QString& ) const;
 
@@ -140,6 +153,16 @@ private:
 
     QSharedPointer<QIODevice> m_input;
 
+    // next track, opened and buffering ahead of time
+    Tomahawk::result_ptr m_preloadedTrack;
+    QSharedPointer<QIODevice> m_preloadedInput;
+    QTimer m_preloadTimer;
+
+    // next track, already handed to phonon's queue for a gapless transition
+    Tomahawk::result_ptr m_queuedTrack;
+    Tomahawk::playlistinterface_ptr m_queuedTrackPlaylist;
+    QSharedPointer<QIODevice> m_queuedInput;
+
     Tomahawk::result_ptr m_currentTrack;
     Tomahawk::result_ptr m_lastTrack;
     Tomahawk::playlistinterface_ptr m_playlist;
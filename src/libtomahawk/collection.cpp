@@ -228,10 +228,39 @@ Collection::delTracks( const QList<unsigned int>& ids )
 }
 
 
+void
+Collection::touchArtists( const QList<Tomahawk::artist_ptr>& artists, const Tomahawk::ArtistAlbumIds& albumIds )
+{
+    // views hear about them once the source is synced, not after every batch
+    foreach ( const artist_ptr& artist, artists )
+    {
+        if ( !m_touchedAlbumIds.contains( artist->id() ) )
+            m_touchedArtists << artist;
+
+        QList<unsigned int>& ids = m_touchedAlbumIds[ artist->id() ];
+        foreach ( unsigned int id, albumIds.value( artist->id() ) )
+        {
+            if ( !ids.contains( id ) )
+                ids << id;
+        }
+    }
+}
+
+
 void
 Collection::onSynced()
 {
-    tDebug() << Q_FUNC_INFO << m_changed;
+    tDebug() << Q_FUNC_INFO << m_changed << m_touchedArtists.count();
+    if ( !m_touchedArtists.isEmpty() )
+    {
+        const QList<Tomahawk::artist_ptr> artists = m_touchedArtists;
+        const Tomahawk::ArtistAlbumIds albumIds = m_touchedAlbumIds;
+        m_touchedArtists.clear();
+        m_touchedAlbumIds.clear();
+
+        emit artistsChanged( artists, albumIds );
+    }
+
     if ( m_changed )
     {
         m_changed = false;
@@ -78,6 +78,8 @@ public:
 signals:
     void tracksAdded( const QList<unsigned int>& fileids );
     void tracksRemoved( const QList<unsigned int>& fileids );
+    // artists and their album ids that files were added to or removed from since the last sync
+    void artistsChanged( const QList<Tomahawk::artist_ptr>& artists, const Tomahawk::ArtistAlbumIds& albumIds );
 
     void playlistsAdded( const QList<Tomahawk::playlist_ptr>& );
     void playlistsDeleted( const QList<Tomahawk::playlist_ptr>& );
@@ -100,6 +102,7 @@ public slots:
 
     void setTracks( const QList<unsigned int>& fileids );
     void delTracks( const QList<unsigned int>& fileids );
+    void touchArtists( const QList<Tomahawk::artist_ptr>& artists, const Tomahawk::ArtistAlbumIds& albumIds );
 
 protected:
     QString m_name;
@@ -111,6 +114,10 @@ private slots:
 private:
     bool m_changed;
 
+    // touched since the last sync
+    QList<Tomahawk::artist_ptr> m_touchedArtists;
+    Tomahawk::ArtistAlbumIds m_touchedAlbumIds;
+
     source_ptr m_source;
     QHash< QString, Tomahawk::playlist_ptr > m_playlists;
     QHash< QString, Tomahawk::dynplaylist_ptr > m_autoplaylists;
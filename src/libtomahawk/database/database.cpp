@@ -19,12 +19,16 @@
 #include "database.h"
 
 #include "databasecommand.h"
+#include "databasecommand_compactoplog.h"
 #include "databaseimpl.h"
 #include "databaseworker.h"
 #include "utils/logger.h"
 
 #define DEFAULT_WORKER_THREADS 4
 #define MAX_WORKER_THREADS 16
+#define MIN_IDLE_WORKER_THREADS 2
+#define WORKER_IDLE_TIMEOUT 60 * 1000
+#define OPLOG_COMPACT_INTERVAL 24 * 60 * 60 * 1000
 
 Database* Database::s_instance = 0;
 
@@ -50,6 +54,15 @@ Database::Database( const QString& dbname, QObject* parent )
     connect( m_impl, SIGNAL( indexReady() ), SIGNAL( indexReady() ) );
     connect( m_impl, SIGNAL( indexReady() ), SIGNAL( ready() ) );
     connect( m_impl, SIGNAL( indexReady() ), SLOT( setIsReadyTrue() ) );
+    connect( m_impl, SIGNAL( indexReady() ), SLOT( compactOplog() ) );
+
+    m_compactTimer.setInterval( OPLOG_COMPACT_INTERVAL );
+    connect( &m_compactTimer, SIGNAL( timeout() ), SLOT( compactOplog() ) );
+    m_compactTimer.start();
+
+    m_retireTimer.setInterval( WORKER_IDLE_TIMEOUT / 2 );
+    connect( &m_retireTimer, SIGNAL( timeout() ), SLOT( retireIdleWorkers() ) );
+    m_retireTimer.start();
 
     m_workerRW->start();
 }
@@ -90,37 +103,84 @@ Database::enqueue( const QSharedPointer<DatabaseCommand>& lc )
     }
     else
     {
-        // find existing amount of worker threads for commandname
-        // create new thread if < WORKER_THREADS
-        if ( m_workers.count() < m_maxConcurrentThreads )
+        DatabaseWorker* worker = 0;
         {
-            DatabaseWorker* worker = new DatabaseWorker( m_impl, this, false );
-            worker->start();
+            QMutexLocker lock( &m_queueMutex );
+            m_queue[ qBound( 0, (int)lc->priority(), (int)DatabaseCommand::InteractivePriority ) ] << lc;
 
-            m_workers << worker;
-        }
-
-        // find thread for commandname with lowest amount of outstanding jobs and enqueue job
-        int busyThreads = 0;
-        DatabaseWorker* happyThread = 0;
-        for ( int i = 0; i < m_workers.count(); i++ )
-        {
-            DatabaseWorker* worker = m_workers.at( i );
-
-            if ( !worker->busy() )
+            // wake up the worker that went idle last, its caches are still warm
+            if ( !m_idleWorkers.isEmpty() )
             {
-                happyThread = worker;
-                break;
+                worker = m_idleWorkers.takeLast();
+                m_idleSince.remove( worker );
             }
-            busyThreads++;
+            else if ( m_workers.count() < m_maxConcurrentThreads )
+            {
+                // everyone is busy, grow the pool
+                worker = new DatabaseWorker( m_impl, this, false );
+                worker->start();
 
-            if ( !happyThread || worker->outstandingJobs() < happyThread->outstandingJobs() )
-                happyThread = worker;
+                m_workers << worker;
+            }
         }
 
-//        qDebug() << "Enqueueing command to thread:" << happyThread << busyThreads << lc->commandname();
-        happyThread->enqueue( lc );
+        // with no worker to spare, the job is picked up by whichever one finishes first
+        if ( worker )
+            QMetaObject::invokeMethod( worker, "doWork", Qt::QueuedConnection );
+    }
+}
+
+
+QSharedPointer<DatabaseCommand>
+Database::takeJob( DatabaseWorker* worker )
+{
+    QMutexLocker lock( &m_queueMutex );
+
+    for ( int i = DatabaseCommand::InteractivePriority; i >= 0; i-- )
+    {
+        if ( !m_queue[ i ].isEmpty() )
+            return m_queue[ i ].takeFirst();
+    }
+
+    if ( !m_idleWorkers.contains( worker ) )
+    {
+        m_idleWorkers << worker;
+        m_idleSince[ worker ].start();
+    }
+
+    return QSharedPointer<DatabaseCommand>();
+}
+
+
+void
+Database::retireIdleWorkers()
+{
+    QList< DatabaseWorker* > retired;
+    {
+        QMutexLocker lock( &m_queueMutex );
+
+        // the longest idle workers are at the front
+        while ( m_idleWorkers.count() > MIN_IDLE_WORKER_THREADS &&
+                m_idleSince.value( m_idleWorkers.first() ).elapsed() > WORKER_IDLE_TIMEOUT )
+        {
+            DatabaseWorker* worker = m_idleWorkers.takeFirst();
+            m_idleSince.remove( worker );
+            m_workers.removeAll( worker );
+            retired << worker;
+        }
     }
+
+    if ( !retired.isEmpty() )
+        tDebug() << "Retiring" << retired.count() << "idle database workers, now using" << m_workers.count();
+
+    qDeleteAll( retired );
+}
+
+
+void
+Database::compactOplog()
+{
+    enqueue( QSharedPointer<DatabaseCommand>( new DatabaseCommand_CompactOplog() ) );
 }
 
 
@@ -21,6 +21,10 @@
 
 #include <QSharedPointer>
 #include <QVariant>
+#include <QHash>
+#include <QTimer>
+#include <QMutex>
+#include <QTime>
 
 #include "artist.h"
 #include "album.h"
@@ -40,6 +44,10 @@ class DatabaseWorker;
     the queue of work. There is a threadpool responsible for exec'ing all
     the non-mutating (readonly) commands and one separate thread for mutating ones,
     so sqlite doesn't write to the Database from multiple threads.
+
+    Readonly commands go into one shared queue, ordered by their priority. Any
+    idle worker picks up the next one, so a long query never holds up the rest.
+    The pool grows while every worker is busy and idle workers are retired again.
 */
 class DLLEXPORT Database : public QObject
 {
@@ -71,10 +79,15 @@ public slots:
 
 private slots:
     void setIsReadyTrue() { m_ready = true; }
+    void compactOplog();
+    void retireIdleWorkers();
 
 private:
     DatabaseImpl* impl() const { return m_impl; }
 
+    // called by the readonly workers, marks the worker idle when there's nothing left to do
+    QSharedPointer<DatabaseCommand> takeJob( DatabaseWorker* worker );
+
     bool m_ready;
     DatabaseImpl* m_impl;
     DatabaseWorker* m_workerRW;
@@ -82,10 +95,19 @@ private:
     bool m_indexReady;
     int m_maxConcurrentThreads;
 
+    QMutex m_queueMutex;
+    QList< QSharedPointer<DatabaseCommand> > m_queue[ DatabaseCommand::InteractivePriority + 1 ];
+    QList< DatabaseWorker* > m_idleWorkers;
+    QHash< DatabaseWorker*, QTime > m_idleSince;
+    QTimer m_retireTimer;
+
+    QTimer m_compactTimer;
+
     static Database* s_instance;
 
     friend class Tomahawk::Artist;
     friend class Tomahawk::Album;
+    friend class DatabaseWorker;
 };
 
 #endif // DATABASE_H
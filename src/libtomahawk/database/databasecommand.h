@@ -44,6 +44,13 @@ public:
         FINISHED = 2
     };
 
+    // read-only commands are picked from the shared queue in this order
+    enum Priority {
+        BackgroundPriority = 0,
+        NormalPriority = 1,
+        InteractivePriority = 2
+    };
+
     explicit DatabaseCommand( QObject* parent = 0 );
     explicit DatabaseCommand( const Tomahawk::source_ptr& src, QObject* parent = 0 );
 
@@ -53,6 +60,7 @@ public:
 
     virtual QString commandname() const { return "DatabaseCommand"; }
     virtual bool doesMutates() const { return true; }
+    virtual Priority priority() const { return NormalPriority; }
     State state() const { return m_state; }
 
     // if i make this pure virtual, i get compile errors in qmetatype.h.
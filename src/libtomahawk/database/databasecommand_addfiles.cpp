@@ -64,6 +64,12 @@ DatabaseCommand_AddFiles::postCommitHook()
 
     emit notify( m_ids );
 
+    // lets views update just the artists and albums that got new files
+    connect( this, SIGNAL( notifyArtists( QList<Tomahawk::artist_ptr>, Tomahawk::ArtistAlbumIds ) ),
+             coll,   SLOT( touchArtists( QList<Tomahawk::artist_ptr>, Tomahawk::ArtistAlbumIds ) ), Qt::QueuedConnection );
+
+    emit notifyArtists( m_artists, m_albumIds );
+
     if ( source()->isLocal() )
         Servent::instance()->triggerDBSync();
 }
@@ -161,6 +167,14 @@ DatabaseCommand_AddFiles::exec( DatabaseImpl* dbi )
 
         m_ids << fileid;
         added++;
+
+        if ( !m_albumIds.contains( artistid ) )
+            m_artists << Artist::get( artistid, artist );
+
+        // albumless files show up under an "Unknown" album with id 0
+        QList<unsigned int>& albumIds = m_albumIds[ artistid ];
+        if ( !albumIds.contains( qMax( albumid, 0 ) ) )
+            albumIds << qMax( albumid, 0 );
     }
     qDebug() << "Inserted" << added << "tracks to database";
 
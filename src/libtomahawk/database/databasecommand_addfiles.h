@@ -56,10 +56,13 @@ public:
 signals:
     void done( const QList<QVariant>&, const Tomahawk::collection_ptr& );
     void notify( const QList<unsigned int>& ids );
+    void notifyArtists( const QList<Tomahawk::artist_ptr>& artists, const Tomahawk::ArtistAlbumIds& albumIds );
 
 private:
     QVariantList m_files;
     QList<unsigned int> m_ids;
+    QList<Tomahawk::artist_ptr> m_artists;
+    Tomahawk::ArtistAlbumIds m_albumIds;
 };
 
 #endif // DATABASECOMMAND_ADDFILES_H
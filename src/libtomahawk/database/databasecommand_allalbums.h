@@ -45,6 +45,7 @@ public:
     virtual void exec( DatabaseImpl* );
 
     virtual bool doesMutates() const { return false; }
+    virtual Priority priority() const { return InteractivePriority; }
     virtual QString commandname() const { return "allalbums"; }
 
     void execForCollection( DatabaseImpl* );
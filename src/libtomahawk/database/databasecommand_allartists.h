@@ -44,6 +44,7 @@ public:
     virtual void exec( DatabaseImpl* );
 
     virtual bool doesMutates() const { return false; }
+    virtual Priority priority() const { return InteractivePriority; }
     virtual QString commandname() const { return "allartists"; }
 
     void setLimit( unsigned int amount ) { m_amount = amount; }
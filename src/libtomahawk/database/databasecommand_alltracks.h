@@ -55,6 +55,7 @@ public:
     virtual void exec( DatabaseImpl* );
 
     virtual bool doesMutates() const { return false; }
+    virtual Priority priority() const { return InteractivePriority; }
     virtual QString commandname() const { return "alltracks"; }
 
     void setArtist( const Tomahawk::artist_ptr& artist ) { m_artist = artist; }
@@ -0,0 +1,128 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Copyright 2010-2011, Christian Muehlhaeuser <muesli@tomahawk-player.org>
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "databasecommand_compactoplog.h"
+
+#include "databaseimpl.h"
+#include "opcodec.h"
+#include "tomahawksqlquery.h"
+#include "utils/logger.h"
+
+// recent ops are left alone, peers that synced lately only need these
+#define OPLOG_TAIL 1000
+// not worth rewriting the snapshot for fewer folded ops than this
+#define OPLOG_COMPACT_MIN 100
+
+
+void
+DatabaseCommand_CompactOplog::exec( DatabaseImpl* dbi )
+{
+    TomahawkSqlQuery query = dbi->newquery();
+    query.prepare( "SELECT id FROM oplog WHERE source IS NULL ORDER BY id DESC LIMIT 1 OFFSET ?" );
+    query.addBindValue( OPLOG_TAIL );
+    query.exec();
+    if ( !query.next() )
+        return;
+
+    const int tailStart = query.value( 0 ).toInt();
+
+    int prevCutoff = 0;
+    QMap< QString, QVariant > files;
+
+    query.exec( "SELECT cutoff, compressed, json FROM oplog_snapshot" );
+    if ( query.next() )
+    {
+        prevCutoff = query.value( 0 ).toInt();
+        const QVariantMap snapshot = OpCodec::fromPayload( query.value( 2 ).toByteArray(), query.value( 1 ).toBool(), true );
+        foreach ( const QVariant& file, snapshot.value( "files" ).toList() )
+            files.insert( file.toMap().value( "id" ).toString(), file );
+    }
+
+    query.prepare( "SELECT count(*) FROM oplog WHERE source IS NULL AND id > ? AND id <= ? "
+                   "AND command IN ( 'addfiles', 'deletefiles' )" );
+    query.addBindValue( prevCutoff );
+    query.addBindValue( tailStart );
+    query.exec();
+    if ( !query.next() || query.value( 0 ).toInt() < OPLOG_COMPACT_MIN )
+        return;
+
+    query.prepare( "SELECT id, guid, command, json, compressed, binary FROM oplog "
+                   "WHERE source IS NULL AND id > ? AND id <= ? "
+                   "AND command IN ( 'addfiles', 'deletefiles' ) ORDER BY id ASC" );
+    query.addBindValue( prevCutoff );
+    query.addBindValue( tailStart );
+    query.exec();
+
+    int cutoff = prevCutoff;
+    QString cutoffGuid;
+    while ( query.next() )
+    {
+        const QVariantMap op = OpCodec::fromPayload( query.value( 3 ).toByteArray(), query.value( 4 ).toBool(), query.value( 5 ).toBool() );
+
+        if ( query.value( 2 ).toString() == "addfiles" )
+        {
+            foreach ( const QVariant& file, op.value( "files" ).toList() )
+                files.insert( file.toMap().value( "id" ).toString(), file );
+        }
+        else if ( op.value( "deleteAll" ).toBool() )
+        {
+            files.clear();
+        }
+        else
+        {
+            foreach ( const QVariant& id, op.value( "ids" ).toList() )
+                files.remove( id.toString() );
+        }
+
+        cutoff = query.value( 0 ).toInt();
+        cutoffGuid = query.value( 1 ).toString();
+    }
+
+    // peers applying the snapshot end up with the last folded op as their lastop
+    QVariantMap snapshot;
+    snapshot.insert( "command", "addfiles" );
+    snapshot.insert( "guid", cutoffGuid );
+    snapshot.insert( "files", QVariantList( files.values() ) );
+
+    QByteArray ba = OpCodec::encode( snapshot );
+    bool compressed = false;
+    if ( ba.length() >= 512 )
+    {
+        ba = qCompress( ba, 9 );
+        compressed = true;
+    }
+
+    tLog() << "Compacting oplog up to" << cutoff << "- snapshot of" << files.count() << "files," << ba.length() << "bytes";
+
+    query.exec( "DELETE FROM oplog_snapshot" );
+    query.prepare( "INSERT INTO oplog_snapshot(cutoff, guid, compressed, json) VALUES(?, ?, ?, ?)" );
+    query.addBindValue( cutoff );
+    query.addBindValue( cutoffGuid );
+    query.addBindValue( compressed );
+    query.addBindValue( ba );
+    if ( !query.exec() )
+        throw "Failed to save oplog snapshot";
+
+    // keep the rows, only their guids are still needed
+    query.prepare( "UPDATE oplog SET command = 'compacted', json = '', compressed = 0, binary = 0 "
+                   "WHERE source IS NULL AND id > ? AND id <= ? AND command IN ( 'addfiles', 'deletefiles' )" );
+    query.addBindValue( prevCutoff );
+    query.addBindValue( cutoff );
+    if ( !query.exec() )
+        throw "Failed to compact oplog";
+}
@@ -0,0 +1,47 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Copyright 2010-2011, Christian Muehlhaeuser <muesli@tomahawk-player.org>
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DATABASECOMMAND_COMPACTOPLOG_H
+#define DATABASECOMMAND_COMPACTOPLOG_H
+
+#include "databasecommand.h"
+
+#include "dllmacro.h"
+
+/**
+  Folds the addfiles/deletefiles history of our oplog, except for the most
+  recent ops, into the collection snapshot in oplog_snapshot.
+
+  Peers that are behind the snapshot (e.g. new ones) get it instead of the
+  folded ops, see DatabaseCommand_loadOps.
+  */
+class DLLEXPORT DatabaseCommand_CompactOplog : public DatabaseCommand
+{
+Q_OBJECT
+
+public:
+    explicit DatabaseCommand_CompactOplog( QObject* parent = 0 )
+        : DatabaseCommand( parent )
+    {}
+
+    virtual void exec( DatabaseImpl* );
+    virtual bool doesMutates() const { return true; }
+    virtual QString commandname() const { return "compactoplog"; }
+};
+
+#endif // DATABASECOMMAND_COMPACTOPLOG_H
@@ -50,6 +50,11 @@ DatabaseCommand_DeleteFiles::postCommitHook()
     tDebug() << "Notifying of deleted tracks:" << m_idList.size() << "from source" << source()->id();
     emit notify( m_idList );
 
+    connect( this, SIGNAL( notifyArtists( QList<Tomahawk::artist_ptr>, Tomahawk::ArtistAlbumIds ) ),
+             coll,   SLOT( touchArtists( QList<Tomahawk::artist_ptr>, Tomahawk::ArtistAlbumIds ) ), Qt::QueuedConnection );
+
+    emit notifyArtists( m_artists, m_albumIds );
+
     if ( source()->isLocal() )
         Servent::instance()->triggerDBSync();
 }
@@ -99,6 +104,9 @@ DatabaseCommand_DeleteFiles::exec( DatabaseImpl* dbi )
 
     if ( m_deleteAll )
     {
+        collectArtists( dbi, QString( "SELECT id FROM file WHERE source %1" )
+                                .arg( source()->isLocal() ? "IS NULL" : QString( "= %1" ).arg( source()->id() ) ) );
+
         delquery.prepare( QString( "DELETE FROM file WHERE source %1" )
                     .arg( source()->isLocal() ? "IS NULL" : QString( "= %1" ).arg( source()->id() ) ) );
         delquery.exec();
@@ -126,6 +134,9 @@ DatabaseCommand_DeleteFiles::exec( DatabaseImpl* dbi )
             idstring.chop( 2 ); //remove the trailing ", "
         }
 
+        if ( !idstring.isEmpty() )
+            collectArtists( dbi, idstring );
+
         delquery.prepare( QString( "DELETE FROM file WHERE source %1 AND id IN ( %2 )" )
                              .arg( source()->isLocal() ? "IS NULL" : QString( "= %1" ).arg( source()->id() ) )
                              .arg( idstring ) );
@@ -137,3 +148,27 @@ DatabaseCommand_DeleteFiles::exec( DatabaseImpl* dbi )
 
     emit done( m_idList, source()->collection() );
 }
+
+
+void
+DatabaseCommand_DeleteFiles::collectArtists( DatabaseImpl* dbi, const QString& fileIds )
+{
+    TomahawkSqlQuery query = dbi->newquery();
+    query.prepare( QString( "SELECT DISTINCT artist.id, artist.name, file_join.album "
+                            "FROM file_join, artist "
+                            "WHERE artist.id = file_join.artist "
+                            "AND file_join.file IN ( %1 )" ).arg( fileIds ) );
+    query.exec();
+
+    while ( query.next() )
+    {
+        const unsigned int artistId = query.value( 0 ).toUInt();
+        if ( !m_albumIds.contains( artistId ) )
+            m_artists << Artist::get( artistId, query.value( 1 ).toString() );
+
+        QList<unsigned int>& albumIds = m_albumIds[ artistId ];
+        const unsigned int albumId = query.value( 2 ).toUInt();
+        if ( !albumIds.contains( albumId ) )
+            albumIds << albumId;
+    }
+}
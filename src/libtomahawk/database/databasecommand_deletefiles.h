@@ -76,12 +76,19 @@ public:
 signals:
     void done( const QList<unsigned int>&, const Tomahawk::collection_ptr& );
     void notify( const QList<unsigned int>& ids );
+    void notifyArtists( const QList<Tomahawk::artist_ptr>& artists, const Tomahawk::ArtistAlbumIds& albumIds );
 
 private:
+    // remembers which artists and albums the files about to be deleted belonged to
+    void collectArtists( DatabaseImpl* dbi, const QString& fileIds );
+
     QDir m_dir;
     QVariantList m_ids;
     QList<unsigned int> m_idList;
     bool m_deleteAll;
+
+    QList<Tomahawk::artist_ptr> m_artists;
+    Tomahawk::ArtistAlbumIds m_albumIds;
 };
 
 #endif // DATABASECOMMAND_DELETEFILES_H
@@ -50,6 +50,7 @@ public:
     
     virtual void exec( DatabaseImpl* );
     virtual bool doesMutates() const { return false; }
+    virtual Priority priority() const { return BackgroundPriority; }
     virtual QString commandname() const { return "filemtimes"; }
 
 signals:
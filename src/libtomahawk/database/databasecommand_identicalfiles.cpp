@@ -0,0 +1,87 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Copyright 2010-2011, Christian Muehlhaeuser <muesli@tomahawk-player.org>
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "databasecommand_identicalfiles.h"
+
+#include "databaseimpl.h"
+#include "source.h"
+#include "sourcelist.h"
+#include "utils/logger.h"
+
+using namespace Tomahawk;
+
+
+DatabaseCommand_IdenticalFiles::DatabaseCommand_IdenticalFiles( const Tomahawk::source_ptr& source, const QString& fileId, QObject* parent )
+    : DatabaseCommand( source, parent )
+    , m_fileId( fileId )
+{
+}
+
+
+void
+DatabaseCommand_IdenticalFiles::exec( DatabaseImpl* dbi )
+{
+    QStringList urls;
+
+    TomahawkSqlQuery query = dbi->newquery();
+    query.prepare( "SELECT file.size, file.duration, file.md5, file_join.artist, file_join.track "
+                   "FROM file, file_join "
+                   "WHERE file.id = file_join.file AND file.source = ? AND file.url = ?" );
+    query.addBindValue( source()->id() );
+    query.addBindValue( m_fileId );
+    query.exec();
+
+    if ( !query.next() )
+    {
+        emit done( urls );
+        return;
+    }
+
+    const unsigned int size = query.value( 0 ).toUInt();
+    const QString md5 = query.value( 2 ).toString();
+
+    TomahawkSqlQuery copies = dbi->newquery();
+    copies.prepare( "SELECT file.source, file.url, file.md5 "
+                    "FROM file, file_join "
+                    "WHERE file.id = file_join.file "
+                    "AND file_join.artist = ? AND file_join.track = ? "
+                    "AND file.size = ? AND file.duration = ? "
+                    "AND file.source IS NOT NULL AND file.source != ?" );
+    copies.addBindValue( query.value( 3 ) );
+    copies.addBindValue( query.value( 4 ) );
+    copies.addBindValue( size );
+    copies.addBindValue( query.value( 1 ) );
+    copies.addBindValue( source()->id() );
+    copies.exec();
+
+    while ( copies.next() )
+    {
+        const QString otherMd5 = copies.value( 2 ).toString();
+        if ( !md5.isEmpty() && !otherMd5.isEmpty() && md5 != otherMd5 )
+            continue;
+
+        source_ptr s = SourceList::instance()->get( copies.value( 0 ).toUInt() );
+        if ( s.isNull() )
+            continue;
+
+        urls << QString( "servent://%1\t%2" ).arg( s->userName() ).arg( copies.value( 1 ).toString() );
+    }
+
+    tDebug( LOGVERBOSE ) << Q_FUNC_INFO << "Found" << urls.count() << "copies of" << m_fileId << "with size" << size;
+    emit done( urls );
+}
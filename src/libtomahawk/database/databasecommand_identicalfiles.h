@@ -0,0 +1,55 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Copyright 2010-2011, Christian Muehlhaeuser <muesli@tomahawk-player.org>
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef DATABASECOMMAND_IDENTICALFILES_H
+#define DATABASECOMMAND_IDENTICALFILES_H
+
+#include <QObject>
+#include <QStringList>
+
+#include "databasecommand.h"
+#include "typedefs.h"
+
+#include "dllmacro.h"
+
+/**
+  Finds copies of a remote file in other sources' collections: same track, size
+  and duration, and the same md5 if both sides know it.
+
+  Emits servent:// urls of the copies, which may belong to sources that are offline.
+  */
+class DLLEXPORT DatabaseCommand_IdenticalFiles : public DatabaseCommand
+{
+Q_OBJECT
+
+public:
+    explicit DatabaseCommand_IdenticalFiles( const Tomahawk::source_ptr& source, const QString& fileId, QObject* parent = 0 );
+
+    virtual void exec( DatabaseImpl* );
+    virtual bool doesMutates() const { return false; }
+    virtual Priority priority() const { return BackgroundPriority; }
+    virtual QString commandname() const { return "identicalfiles"; }
+
+signals:
+    void done( const QStringList& urls );
+
+private:
+    QString m_fileId;
+};
+
+#endif // DATABASECOMMAND_IDENTICALFILES_H
@@ -19,7 +19,10 @@
 #include "databasecommand_loadops.h"
 
 #include "databaseimpl.h"
+#include "opcodec.h"
 #include "tomahawksqlquery.h"
+
+#include <qjson/serializer.h>
 #include "source.h"
 #include "utils/logger.h"
 
@@ -28,6 +31,7 @@ void
 DatabaseCommand_loadOps::exec( DatabaseImpl* dbi )
 {
     QList< dbop_ptr > ops;
+    int sinceId = 0;
 
     if ( !m_since.isEmpty() )
     {
@@ -43,21 +47,63 @@ DatabaseCommand_loadOps::exec( DatabaseImpl* dbi )
             emit done( m_since, m_since, ops );
             return;
         }
+
+        sinceId = query.value( 0 ).toInt();
+    }
+
+    if ( source()->isLocal() )
+    {
+        TomahawkSqlQuery query = dbi->newquery();
+        query.exec( "SELECT cutoff, guid, compressed, json FROM oplog_snapshot" );
+
+        // the peer misses some of the file ops we folded, so it gets the whole snapshot instead
+        if ( query.next() && sinceId < query.value( 0 ).toInt() )
+        {
+            if ( sinceId > 0 )
+            {
+                // clear out what they have first. If they get interrupted after this, they'll
+                // still ask for ops since m_since next time and get all of it again
+                QVariantMap wipe;
+                wipe.insert( "command", "deletefiles" );
+                wipe.insert( "guid", m_since );
+                wipe.insert( "deleteAll", true );
+                wipe.insert( "ids", QVariantList() );
+
+                dbop_ptr wipeOp( new DBOp );
+                wipeOp->guid = m_since;
+                wipeOp->command = "deletefiles";
+                wipeOp->payload = OpCodec::encode( wipe );
+                wipeOp->compressed = false;
+                wipeOp->singleton = false;
+                wipeOp->binary = true;
+                ops << wipeOp;
+            }
+
+            dbop_ptr snapshotOp( new DBOp );
+            snapshotOp->guid = query.value( 1 ).toString();
+            snapshotOp->command = "addfiles";
+            snapshotOp->payload = query.value( 3 ).toByteArray();
+            snapshotOp->compressed = query.value( 2 ).toBool();
+            snapshotOp->singleton = false;
+            snapshotOp->binary = true;
+            ops << snapshotOp;
+        }
     }
 
     TomahawkSqlQuery query = dbi->newquery();
     query.prepare( QString(
-                   "SELECT guid, command, json, compressed, singleton "
+                   "SELECT guid, command, json, compressed, singleton, binary "
                    "FROM oplog "
                    "WHERE source %1 "
                    "AND id > coalesce((SELECT id FROM oplog WHERE guid = ?),0) "
+                   "AND command != 'compacted' "
                    "ORDER BY id ASC"
                    ).arg( source()->isLocal() ? "IS NULL" : QString( "= %1" ).arg( source()->id() ) )
                   );
     query.addBindValue( m_since );
     query.exec();
 
-    QString lastguid = m_since;
+    QString lastguid = ops.isEmpty() ? m_since : ops.last()->guid;
     while( query.next() )
     {
         dbop_ptr op( new DBOp );
@@ -66,6 +112,27 @@ DatabaseCommand_loadOps::exec( DatabaseImpl* dbi )
         op->payload = query.value( 2 ).toByteArray();
         op->compressed = query.value( 3 ).toBool();
         op->singleton = query.value( 4 ).toBool();
+        op->binary = query.value( 5 ).toBool();
+
+        // dynamic playlist revisions carry deltas too, so go by the payload and not the command
+        if ( m_expandDeltas )
+        {
+            QVariantMap m = OpCodec::fromPayload( op->payload, op->compressed, op->binary );
+            if ( !m.value( "entrydelta" ).toMap().isEmpty() )
+            {
+                QVariantList orderedguids;
+                foreach ( const QString& guid, dbi->playlistRevisionEntries( m.value( "newrev" ).toString() ) )
+                    orderedguids << guid;
+
+                m.remove( "entrydelta" );
+                m.insert( "orderedguids", orderedguids );
+
+                QJson::Serializer serializer;
+                op->payload = serializer.serialize( m );
+                op->compressed = false;
+                op->binary = false;
+            }
+        }
 
         lastguid = op->guid;
         ops << op;
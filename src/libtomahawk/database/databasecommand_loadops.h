@@ -30,13 +30,17 @@ class DLLEXPORT DatabaseCommand_loadOps : public DatabaseCommand
 Q_OBJECT
 public:
     explicit DatabaseCommand_loadOps( const Tomahawk::source_ptr& src, QString since, QObject* parent = 0 )
-        : DatabaseCommand( src ), m_since( since )
+        : DatabaseCommand( src ), m_since( since ), m_expandDeltas( false )
     {
         Q_UNUSED( parent );
     }
 
+    // for peers that don't understand playlist revision deltas
+    void setExpandDeltas( bool expand ) { m_expandDeltas = expand; }
+
     virtual void exec( DatabaseImpl* db );
     virtual bool doesMutates() const { return false; }
+    virtual Priority priority() const { return BackgroundPriority; }
     virtual QString commandname() const { return "loadops"; }
 
 signals:
@@ -44,6 +48,7 @@ signals:
 
 private:
     QString m_since; // guid to load from
+    bool m_expandDeltas;
 };
 
 #endif // DATABASECOMMAND_LOADOPS_H
@@ -19,10 +19,10 @@
 #include "databasecommand_loadplaylistentries.h"
 
 #include <QSqlQuery>
+#include <QSet>
 
 #include "databaseimpl.h"
 #include "query.h"
-#include "qjson/parser.h"
 #include "utils/logger.h"
 
 using namespace Tomahawk;
@@ -41,7 +41,7 @@ void
 DatabaseCommand_LoadPlaylistEntries::generateEntries( DatabaseImpl* dbi )
 {
     TomahawkSqlQuery query_entries = dbi->newquery();
-    query_entries.prepare( "SELECT entries, playlist, author, timestamp, previous_revision "
+    query_entries.prepare( "SELECT playlist, previous_revision "
                            "FROM playlist_revision "
                            "WHERE guid = :guid" );
     query_entries.bindValue( ":guid", m_revguid );
@@ -49,25 +49,25 @@ DatabaseCommand_LoadPlaylistEntries::generateEntries( DatabaseImpl* dbi )
 
     tLog( LOGVERBOSE ) << "trying to load playlist entries for guid:" << m_revguid;
     QString prevrev;
-    QJson::Parser parser; bool ok;
 
     if ( query_entries.next() )
     {
-        // entries should be a list of strings:
-        QVariant v = parser.parse( query_entries.value( 0 ).toByteArray(), &ok );
-        Q_ASSERT( ok && v.type() == QVariant::List ); //TODO
-        m_guids = v.toStringList();
-        QString inclause = QString( "('%1')" ).arg( m_guids.join( "', '" ) );
+        m_guids = dbi->playlistRevisionEntries( m_revguid );
+        const QSet< QString > guids = m_guids.toSet();
 
+        // all items ever added to the playlist, which is cheap thanks to the index on playlist
         TomahawkSqlQuery query = dbi->newquery();
-        QString sql = QString( "SELECT guid, trackname, artistname, albumname, annotation, "
-                               "duration, addedon, addedby, result_hint "
-                               "FROM playlist_item "
-                               "WHERE guid IN %1" ).arg( inclause );
-
-        query.exec( sql );
+        query.prepare( "SELECT guid, trackname, artistname, albumname, annotation, "
+                       "duration, addedon, addedby, result_hint "
+                       "FROM playlist_item "
+                       "WHERE playlist = ?" );
+        query.addBindValue( query_entries.value( 0 ).toString() );
+        query.exec();
         while ( query.next() )
         {
+            if ( !guids.contains( query.value( 0 ).toString() ) )
+                continue;
+
             plentry_ptr e( new PlaylistEntry );
             e->setGuid( query.value( 0 ).toString() );
             e->setAnnotation( query.value( 4 ).toString() );
@@ -82,7 +82,7 @@ DatabaseCommand_LoadPlaylistEntries::generateEntries( DatabaseImpl* dbi )
             m_entrymap.insert( e->guid(), e );
         }
 
-        prevrev = query_entries.value( 4 ).toString();
+        prevrev = query_entries.value( 1 ).toString();
     }
     else
     {
@@ -92,12 +92,11 @@ DatabaseCommand_LoadPlaylistEntries::generateEntries( DatabaseImpl* dbi )
     if ( prevrev.length() )
     {
         TomahawkSqlQuery query_entries_old = dbi->newquery();
-        query_entries_old.prepare( "SELECT entries, "
-                                   "(SELECT currentrevision = ? FROM playlist WHERE guid = ?) "
+        query_entries_old.prepare( "SELECT (SELECT currentrevision = ? FROM playlist WHERE guid = ?) "
                                    "FROM playlist_revision "
                                    "WHERE guid = ?" );
         query_entries_old.addBindValue( m_revguid );
-        query_entries_old.addBindValue( query_entries.value( 1 ).toString() );
+        query_entries_old.addBindValue( query_entries.value( 0 ).toString() );
         query_entries_old.addBindValue( prevrev );
 
         query_entries_old.exec();
@@ -107,10 +106,8 @@ DatabaseCommand_LoadPlaylistEntries::generateEntries( DatabaseImpl* dbi )
             Q_ASSERT( false );
         }
 
-        QVariant v = parser.parse( query_entries_old.value( 0 ).toByteArray(), &ok );
-        Q_ASSERT( ok && v.type() == QVariant::List ); //TODO
-        m_oldentries = v.toStringList();
-        m_islatest = query_entries_old.value( 1 ).toBool();
+        m_oldentries = dbi->playlistRevisionEntries( prevrev );
+        m_islatest = query_entries_old.value( 0 ).toBool();
     }
 
 //    qDebug() << Q_FUNC_INFO << "entrymap:" << m_entrymap;
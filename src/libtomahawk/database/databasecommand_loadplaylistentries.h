@@ -38,6 +38,7 @@ public:
 
     virtual void exec( DatabaseImpl* );
     virtual bool doesMutates() const { return false; }
+    virtual Priority priority() const { return InteractivePriority; }
     virtual QString commandname() const { return "loadplaylistentries"; }
 
     QString revisionGuid() const { return m_revguid; }
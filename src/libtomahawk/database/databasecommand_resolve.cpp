@@ -124,7 +124,9 @@ DatabaseCommand_Resolve::resolve( DatabaseImpl* lib )
                             "artist.id = file_join.artist AND "
                             "track.id = file_join.track AND "
                             "file.id = file_join.file AND "
-                            "(%1 AND %2)" )
+                            "%1 AND "
+                            "(%2 AND %3)" )
+         .arg( onlineSourcesToken() )
          .arg( artsToken )
          .arg( trksToken );
 
@@ -194,6 +196,21 @@ DatabaseCommand_Resolve::resolve( DatabaseImpl* lib )
 }
 
 
+QString
+DatabaseCommand_Resolve::onlineSourcesToken() const
+{
+    // only look at files we could actually play right now: our own, and those of peers that are online
+    QStringList ids;
+    foreach ( int id, SourceList::instance()->onlineSourceIds() )
+        ids << QString::number( id );
+
+    if ( ids.isEmpty() )
+        return QString( "file.source IS NULL" );
+
+    return QString( "(file.source IS NULL OR file.source IN (%1))" ).arg( ids.join( "," ) );
+}
+
+
 void
 DatabaseCommand_Resolve::fullTextResolve( DatabaseImpl* lib )
 {
@@ -283,7 +300,9 @@ DatabaseCommand_Resolve::fullTextResolve( DatabaseImpl* lib )
                             "artist.id = file_join.artist AND "
                             "track.id = file_join.track AND "
                             "file.id = file_join.file AND "
-                            "%1" )
+                            "%1 AND "
+                            "%2" )
+                        .arg( onlineSourcesToken() )
                         .arg( trackPairs.length() > 0 ? trksToken : QString( "0" ) );
 
     files_query.prepare( sql );
@@ -51,6 +51,7 @@ private:
 
     void fullTextResolve( DatabaseImpl* lib );
     void resolve( DatabaseImpl* lib );
+    QString onlineSourcesToken() const;
 
     Tomahawk::query_ptr m_query;
 };
@@ -26,6 +26,9 @@
 #include "network/servent.h"
 #include "utils/logger.h"
 
+// store the full list every this many revisions, so loading never walks a long chain of deltas
+#define PLAYLIST_CHECKPOINT_INTERVAL 16
+
 using namespace Tomahawk;
 
 
@@ -109,10 +112,6 @@ DatabaseCommand_SetPlaylistRevision::exec( DatabaseImpl* lib )
         return;
     }
 
-    QVariantList vlist = m_orderedguids;
-    QJson::Serializer ser;
-    const QByteArray entries = ser.serialize( vlist );
-
     // add any new items:
     TomahawkSqlQuery adde = lib->newquery();
     if ( m_localOnly )
@@ -164,6 +163,34 @@ DatabaseCommand_SetPlaylistRevision::exec( DatabaseImpl* lib )
         }
     }
 
+    int depth = 0;
+    QStringList previousEntries;
+    if ( !m_oldrev.isEmpty() )
+        previousEntries = lib->playlistRevisionEntries( m_oldrev, &depth );
+
+    // a peer sent us just the changes to the previous revision
+    if ( m_orderedguids.isEmpty() && !m_entryDelta.isEmpty() )
+    {
+        foreach ( const QString& guid, applyEntriesDelta( previousEntries, m_entryDelta ) )
+            m_orderedguids << guid;
+    }
+
+    QStringList orderedEntries;
+    foreach ( const QVariant& v, m_orderedguids )
+        orderedEntries << v.toString();
+
+    // store and send a delta, unless it's time for a full list again or the delta wouldn't be much smaller
+    m_entryDelta.clear();
+    if ( !m_oldrev.isEmpty() && depth + 1 < PLAYLIST_CHECKPOINT_INTERVAL )
+    {
+        const QVariantMap delta = entriesDelta( previousEntries, orderedEntries );
+        if ( delta.value( "insert" ).toList().count() * 2 < orderedEntries.count() )
+            m_entryDelta = delta;
+    }
+
+    QJson::Serializer ser;
+    const QByteArray entries = m_entryDelta.isEmpty() ? ser.serialize( m_orderedguids ) : ser.serialize( m_entryDelta );
+
     // add / update the revision:
     TomahawkSqlQuery query = lib->newquery();
     QString sql = "INSERT INTO playlist_revision(guid, playlist, entries, author, timestamp, previous_revision) "
@@ -192,23 +219,8 @@ DatabaseCommand_SetPlaylistRevision::exec( DatabaseImpl* lib )
 
         m_applied = true;
 
-        // load previous revision entries, which we need to pass on
-        // so the change can be diffed
-        TomahawkSqlQuery query_entries = lib->newquery();
-        query_entries.prepare( "SELECT entries, playlist, author, timestamp, previous_revision "
-                               "FROM playlist_revision "
-                               "WHERE guid = :guid" );
-        query_entries.bindValue( ":guid", m_oldrev );
-        query_entries.exec();
-        if ( query_entries.next() )
-        {
-            bool ok;
-            QJson::Parser parser;
-            QVariant v = parser.parse( query_entries.value( 0 ).toByteArray(), &ok );
-            Q_ASSERT( ok && v.type() == QVariant::List ); //TODO
-
-            m_previous_rev_orderedguids = v.toStringList();
-        }
+        // pass on the previous revision entries, so the change can be diffed
+        m_previous_rev_orderedguids = previousEntries;
     }
     else if ( !m_oldrev.isEmpty() )
     {
@@ -216,3 +228,40 @@ DatabaseCommand_SetPlaylistRevision::exec( DatabaseImpl* lib )
 //        Q_ASSERT( false );
     }
 }
+
+
+QVariantMap
+DatabaseCommand_SetPlaylistRevision::entriesDelta( const QStringList& from, const QStringList& to )
+{
+    int prefix = 0;
+    while ( prefix < from.count() && prefix < to.count() && from.at( prefix ) == to.at( prefix ) )
+        prefix++;
+
+    int suffix = 0;
+    while ( suffix < from.count() - prefix && suffix < to.count() - prefix &&
+            from.at( from.count() - suffix - 1 ) == to.at( to.count() - suffix - 1 ) )
+        suffix++;
+
+    QVariantList insert;
+    foreach ( const QString& guid, to.mid( prefix, to.count() - prefix - suffix ) )
+        insert << guid;
+
+    QVariantMap delta;
+    delta.insert( "prefix", prefix );
+    delta.insert( "suffix", suffix );
+    delta.insert( "insert", insert );
+    return delta;
+}
+
+
+QStringList
+DatabaseCommand_SetPlaylistRevision::applyEntriesDelta( const QStringList& from, const QVariantMap& delta )
+{
+    const int prefix = qMin( delta.value( "prefix" ).toInt(), from.count() );
+    const int suffix = qMin( delta.value( "suffix" ).toInt(), from.count() - prefix );
+
+    QStringList entries = from.mid( 0, prefix );
+    entries << delta.value( "insert" ).toStringList();
+    entries << from.mid( from.count() - suffix );
+    return entries;
+}
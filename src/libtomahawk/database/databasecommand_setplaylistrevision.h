@@ -33,7 +33,8 @@ Q_OBJECT
 Q_PROPERTY( QString playlistguid      READ playlistguid  WRITE setPlaylistguid )
 Q_PROPERTY( QString newrev            READ newrev        WRITE setNewrev )
 Q_PROPERTY( QString oldrev            READ oldrev        WRITE setOldrev )
-Q_PROPERTY( QVariantList orderedguids READ orderedguids  WRITE setOrderedguids )
+Q_PROPERTY( QVariantList orderedguids READ orderedguidsV WRITE setOrderedguids )
+Q_PROPERTY( QVariantMap entrydelta    READ entryDelta    WRITE setEntryDelta )
 Q_PROPERTY( QVariantList addedentries READ addedentriesV WRITE setAddedentriesV )
 
 public:
@@ -92,6 +93,15 @@ public:
 
     void setOrderedguids( const QVariantList& l ) { m_orderedguids = l; }
     QVariantList orderedguids() const { return m_orderedguids; }
+    // peers only get the full list when we don't send them a delta
+    QVariantList orderedguidsV() const { return m_entryDelta.isEmpty() ? m_orderedguids : QVariantList(); }
+
+    // changes to the entries of the previous revision: keep 'prefix' and 'suffix' entries, put 'insert' in between
+    void setEntryDelta( const QVariantMap& delta ) { m_entryDelta = delta; }
+    QVariantMap entryDelta() const { return m_entryDelta; }
+
+    static QVariantMap entriesDelta( const QStringList& from, const QStringList& to );
+    static QStringList applyEntriesDelta( const QStringList& from, const QVariantMap& delta );
 
 protected:
     bool m_applied;
@@ -104,6 +114,7 @@ protected:
 
 private:
     QVariantList m_orderedguids;
+    QVariantMap m_entryDelta;
     QList<Tomahawk::plentry_ptr> m_addedentries, m_entries;
 
     bool m_localOnly;
@@ -25,8 +25,12 @@
 #include <QtAlgorithms>
 #include <QFile>
 
+#include <qjson/parser.h>
+
 #include "database/database.h"
 #include "databasecommand_updatesearchindex.h"
+#include "databasecommand_setplaylistrevision.h"
+#include "opcodec.h"
 #include "sourcelist.h"
 #include "result.h"
 #include "artist.h"
@@ -40,7 +44,7 @@
 */
 #include "schema.sql.h"
 
-#define CURRENT_SCHEMA_VERSION 28
+#define CURRENT_SCHEMA_VERSION 30
 
 
 DatabaseImpl::DatabaseImpl( const QString& dbname, Database* parent )
@@ -116,7 +120,8 @@ DatabaseImpl::dumpDatabase()
                     << "GUID: " << query.value( 2 ).toString() << endl
                     << "Command: " << query.value( 3 ).toString() << endl
                     << "Singleton: " << query.value( 4 ).toBool() << endl
-                    << "JSON: " << ( query.value( 5 ).toBool() ? qUncompress( query.value( 6 ).toByteArray() ) : query.value( 6 ).toByteArray() )
+                    << "JSON: " << ( query.value( 7 ).toBool() ? OpCodec::toJson( query.value( 6 ).toByteArray(), query.value( 5 ).toBool() ) :
+                                     query.value( 5 ).toBool() ? qUncompress( query.value( 6 ).toByteArray() ) : query.value( 6 ).toByteArray() )
                     << endl << endl << endl;
         }
     }
@@ -696,3 +701,46 @@ DatabaseImpl::openDatabase( const QString& dbname )
 
     return schemaUpdated;
 }
+
+
+QStringList
+DatabaseImpl::playlistRevisionEntries( const QString& revguid, int* depth )
+{
+    // revisions are either a full list of guids or a delta to their previous revision,
+    // walk back to the last full one and apply the deltas from there
+    QList< QVariantMap > deltas;
+    QStringList entries;
+    QString rev = revguid;
+    QJson::Parser parser;
+
+    TomahawkSqlQuery query = newquery();
+    query.prepare( "SELECT entries, previous_revision FROM playlist_revision WHERE guid = ?" );
+    while ( !rev.isEmpty() )
+    {
+        query.bindValue( 0, rev );
+        query.exec();
+        if ( !query.next() )
+        {
+            tLog() << "Missing playlist revision:" << rev;
+            break;
+        }
+
+        const QVariant v = parser.parse( query.value( 0 ).toByteArray() );
+        if ( v.type() != QVariant::Map )
+        {
+            entries = v.toStringList();
+            break;
+        }
+
+        deltas.prepend( v.toMap() );
+        rev = query.value( 1 ).toString();
+    }
+
+    if ( depth )
+        *depth = deltas.count();
+
+    foreach ( const QVariantMap& delta, deltas )
+        entries = DatabaseCommand_SetPlaylistRevision::applyEntriesDelta( entries, delta );
+
+    return entries;
+}
@@ -24,6 +24,7 @@
 #include <QPair>
 #include <QVariant>
 #include <QVariantMap>
+#include <QStringList>
 #include <QSqlDatabase>
 #include <QSqlError>
 #include <QSqlQuery>
@@ -67,6 +68,9 @@ public:
     Tomahawk::result_ptr file( int fid );
     Tomahawk::result_ptr resultFromHint( const Tomahawk::query_ptr& query );
 
+    // ordered entry guids of a playlist revision, depth is set to the number of deltas applied
+    QStringList playlistRevisionEntries( const QString& revguid, int* depth = 0 );
+
     static bool scorepairSorter( const QPair<int,float>& left, const QPair<int,float>& right )
     {
         return left.second > right.second;
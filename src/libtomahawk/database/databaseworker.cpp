@@ -26,6 +26,7 @@
 #include "database.h"
 #include "databaseimpl.h"
 #include "databasecommandloggable.h"
+#include "opcodec.h"
 #include "tomahawksqlquery.h"
 #include "utils/logger.h"
 
@@ -35,12 +36,11 @@
 
 DatabaseWorker::DatabaseWorker( DatabaseImpl* lib, Database* db, bool mutates )
     : QThread()
+    , m_db( db )
     , m_dbimpl( lib )
+    , m_mutates( mutates )
     , m_outstanding( 0 )
 {
-    Q_UNUSED( db );
-    Q_UNUSED( mutates );
-
     moveToThread( this );
 
     qDebug() << "CTOR DatabaseWorker" << this->thread();
@@ -114,10 +114,17 @@ DatabaseWorker::doWork()
 
     QList< QSharedPointer<DatabaseCommand> > cmdGroup;
     QSharedPointer<DatabaseCommand> cmd;
+    if ( m_mutates )
     {
         QMutexLocker lock( &m_mut );
         cmd = m_commands.takeFirst();
     }
+    else
+    {
+        cmd = m_db->takeJob( this );
+        if ( cmd.isNull() )
+            return;
+    }
 
     if ( cmd->doesMutates() )
     {
@@ -238,6 +245,13 @@ DatabaseWorker::doWork()
     foreach ( QSharedPointer<DatabaseCommand> c, cmdGroup )
         c->emitFinished();
 
+    if ( !m_mutates )
+    {
+        // keep draining the shared queue, but let our event loop breathe in between
+        QTimer::singleShot( 0, this, SLOT( doWork() ) );
+        return;
+    }
+
     QMutexLocker lock( &m_mut );
     m_outstanding -= completed;
     if ( m_outstanding > 0 )
@@ -250,11 +264,11 @@ void
 DatabaseWorker::logOp( DatabaseCommandLoggable* command )
 {
     TomahawkSqlQuery oplogquery = m_dbimpl->newquery();
-    oplogquery.prepare( "INSERT INTO oplog(source, guid, command, singleton, compressed, json) "
-                        "VALUES(?, ?, ?, ?, ?, ?)" );
+    oplogquery.prepare( "INSERT INTO oplog(source, guid, command, singleton, compressed, json, binary) "
+                        "VALUES(?, ?, ?, ?, ?, ?, ?)" );
 
     QVariantMap variant = QJson::QObjectHelper::qobject2qvariant( command );
-    QByteArray ba = m_serializer.serialize( variant );
+    QByteArray ba = OpCodec::encode( variant );
 
 //     qDebug() << "OP JSON:" << ba.isNull() << ba << "from:" << variant; // debug
 
@@ -293,6 +307,7 @@ DatabaseWorker::logOp( DatabaseCommandLoggable* command )
     oplogquery.bindValue( 3, command->singletonCmd() );
     oplogquery.bindValue( 4, compressed );
     oplogquery.bindValue( 5, ba );
+    oplogquery.bindValue( 6, true );
     if( !oplogquery.exec() )
     {
         tLog() << "Error saving to oplog";
@@ -25,8 +25,6 @@
 #include <QList>
 #include <QSharedPointer>
 
-#include <qjson/parser.h>
-#include <qjson/serializer.h>
 #include <qjson/qobjecthelper.h>
 
 #include "databasecommand.h"
@@ -53,17 +51,18 @@ protected:
     void run();
 
 private slots:
+    // readonly workers get this invoked by Database when there is work in the shared queue
     void doWork();
 
 private:
     void logOp( DatabaseCommandLoggable* command );
 
     QMutex m_mut;
+    Database* m_db;
     DatabaseImpl* m_dbimpl;
+    bool m_mutates;
     QList< QSharedPointer<DatabaseCommand> > m_commands;
     int m_outstanding;
-
-    QJson::Serializer m_serializer;
 };
 
 #endif // DATABASEWORKER_H
@@ -29,6 +29,7 @@ struct DBOp
     QByteArray payload;
     bool compressed;
     bool singleton;
+    bool binary;
 };
 
 typedef QSharedPointer<DBOp> dbop_ptr;
@@ -0,0 +1,467 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Copyright 2010-2011, Christian Muehlhaeuser <muesli@tomahawk-player.org>
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "opcodec.h"
+
+#include <QDataStream>
+#include <QHash>
+#include <QStringList>
+#include <QtEndian>
+
+#include <qjson/parser.h>
+#include <qjson/serializer.h>
+
+#include "utils/logger.h"
+
+#define OPCODEC_VERSION 1
+
+// ops come from peers: lists, maps and tables nested deeper than this are corrupt
+#define MAX_NESTING_DEPTH 32
+
+namespace
+{
+    enum Tag
+    {
+        TagNull = 0,
+        TagBool,
+        TagInt,
+        TagUInt,
+        TagLongLong,
+        TagULongLong,
+        TagDouble,
+        TagString,
+        TagList,
+        TagMap,
+        TagTable,
+        TagOther
+    };
+
+    class Writer
+    {
+    public:
+        Writer( QDataStream& out ) : m_out( out ) {}
+
+        void write( const QVariant& v );
+        const QStringList& strings() const { return m_strings; }
+
+    private:
+        void writeString( const QString& s );
+        bool isTable( const QVariantList& list ) const;
+
+        QDataStream& m_out;
+        QStringList m_strings;
+        QHash< QString, quint32 > m_index;
+    };
+
+    class Reader
+    {
+    public:
+        Reader( QDataStream& in, const QStringList& strings ) : m_in( in ), m_strings( strings ), m_depth( 0 ) {}
+
+        QVariant read();
+
+        static bool fits( QDataStream& in, quint32 count, quint32 minSize );
+
+    private:
+        QString readString();
+
+        QDataStream& m_in;
+        const QStringList& m_strings;
+        int m_depth;
+    };
+}
+
+
+void
+Writer::writeString( const QString& s )
+{
+    QHash< QString, quint32 >::const_iterator it = m_index.constFind( s );
+    if ( it != m_index.constEnd() )
+    {
+        m_out << it.value();
+        return;
+    }
+
+    const quint32 idx = m_strings.count();
+    m_index.insert( s, idx );
+    m_strings << s;
+    m_out << idx;
+}
+
+
+bool
+Writer::isTable( const QVariantList& list ) const
+{
+    if ( list.count() < 2 || list.first().type() != QVariant::Map )
+        return false;
+
+    const QStringList keys = list.first().toMap().keys();
+    foreach ( const QVariant& v, list )
+    {
+        if ( v.type() != QVariant::Map || v.toMap().keys() != keys )
+            return false;
+    }
+
+    return true;
+}
+
+
+void
+Writer::write( const QVariant& v )
+{
+    switch ( v.type() )
+    {
+        case QVariant::Invalid:
+            m_out << (quint8)TagNull;
+            break;
+
+        case QVariant::Bool:
+            m_out << (quint8)TagBool << v.toBool();
+            break;
+
+        case QVariant::Int:
+            m_out << (quint8)TagInt << (qint32)v.toInt();
+            break;
+
+        case QVariant::UInt:
+            m_out << (quint8)TagUInt << (quint32)v.toUInt();
+            break;
+
+        case QVariant::LongLong:
+            m_out << (quint8)TagLongLong << (qint64)v.toLongLong();
+            break;
+
+        case QVariant::ULongLong:
+            m_out << (quint8)TagULongLong << (quint64)v.toULongLong();
+            break;
+
+        case QVariant::Double:
+            m_out << (quint8)TagDouble << v.toDouble();
+            break;
+
+        case QVariant::String:
+            m_out << (quint8)TagString;
+            writeString( v.toString() );
+            break;
+
+        case QVariant::List:
+        {
+            const QVariantList list = v.toList();
+            if ( isTable( list ) )
+            {
+                // keys once, then the values row by row
+                const QStringList keys = list.first().toMap().keys();
+                m_out << (quint8)TagTable << (quint32)keys.count();
+                foreach ( const QString& key, keys )
+                    writeString( key );
+
+                m_out << (quint32)list.count();
+                foreach ( const QVariant& row, list )
+                {
+                    foreach ( const QVariant& value, row.toMap() )
+                        write( value );
+                }
+            }
+            else
+            {
+                m_out << (quint8)TagList << (quint32)list.count();
+                foreach ( const QVariant& value, list )
+                    write( value );
+            }
+            break;
+        }
+
+        case QVariant::Map:
+        {
+            const QVariantMap map = v.toMap();
+            m_out << (quint8)TagMap << (quint32)map.count();
+            foreach ( const QString& key, map.keys() )
+            {
+                writeString( key );
+                write( map.value( key ) );
+            }
+            break;
+        }
+
+        default:
+            m_out << (quint8)TagOther << v;
+            break;
+    }
+}
+
+
+// can count items of at least minSize bytes each still be in the stream?
+// Counts are read from the peer and must not make us loop or allocate for nothing
+bool
+Reader::fits( QDataStream& in, quint32 count, quint32 minSize )
+{
+    if ( in.status() != QDataStream::Ok || (quint64)count * minSize > (quint64)in.device()->bytesAvailable() )
+    {
+        in.setStatus( QDataStream::ReadCorruptData );
+        return false;
+    }
+
+    return true;
+}
+
+
+QString
+Reader::readString()
+{
+    quint32 idx;
+    m_in >> idx;
+    if ( idx >= (quint32)m_strings.count() )
+    {
+        m_in.setStatus( QDataStream::ReadCorruptData );
+        return QString();
+    }
+
+    return m_strings.at( idx );
+}
+
+
+QVariant
+Reader::read()
+{
+    quint8 tag;
+    m_in >> tag;
+
+    switch ( tag )
+    {
+        case TagNull:
+            return QVariant();
+
+        case TagBool:
+        {
+            bool b;
+            m_in >> b;
+            return b;
+        }
+
+        case TagInt:
+        {
+            qint32 i;
+            m_in >> i;
+            return (int)i;
+        }
+
+        case TagUInt:
+        {
+            quint32 i;
+            m_in >> i;
+            return (uint)i;
+        }
+
+        case TagLongLong:
+        {
+            qint64 i;
+            m_in >> i;
+            return (qlonglong)i;
+        }
+
+        case TagULongLong:
+        {
+            quint64 i;
+            m_in >> i;
+            return (qulonglong)i;
+        }
+
+        case TagDouble:
+        {
+            double d;
+            m_in >> d;
+            return d;
+        }
+
+        case TagString:
+            return readString();
+
+        case TagList:
+        {
+            quint32 count;
+            m_in >> count;
+
+            // every value takes at least its tag
+            if ( !fits( m_in, count, 1 ) || m_depth >= MAX_NESTING_DEPTH )
+                break;
+
+            m_depth++;
+            QVariantList list;
+            for ( quint32 i = 0; i < count && m_in.status() == QDataStream::Ok; i++ )
+                list << read();
+            m_depth--;
+            return list;
+        }
+
+        case TagMap:
+        {
+            quint32 count;
+            m_in >> count;
+
+            // string index and value tag
+            if ( !fits( m_in, count, 5 ) || m_depth >= MAX_NESTING_DEPTH )
+                break;
+
+            m_depth++;
+            QVariantMap map;
+            for ( quint32 i = 0; i < count && m_in.status() == QDataStream::Ok; i++ )
+            {
+                const QString key = readString();
+                map.insert( key, read() );
+            }
+            m_depth--;
+            return map;
+        }
+
+        case TagTable:
+        {
+            quint32 cols, rows;
+            m_in >> cols;
+
+            if ( !fits( m_in, cols, 4 ) || m_depth >= MAX_NESTING_DEPTH )
+                break;
+
+            QStringList keys;
+            for ( quint32 i = 0; i < cols && m_in.status() == QDataStream::Ok; i++ )
+                keys << readString();
+
+            m_in >> rows;
+
+            // rows without columns don't take up any bytes, we never write those
+            if ( ( cols == 0 && rows > 0 ) || !fits( m_in, rows, cols ) )
+                break;
+
+            m_depth++;
+            QVariantList list;
+            for ( quint32 r = 0; r < rows && m_in.status() == QDataStream::Ok; r++ )
+            {
+                QVariantMap row;
+                foreach ( const QString& key, keys )
+                    row.insert( key, read() );
+                list << row;
+            }
+            m_depth--;
+            return list;
+        }
+
+        case TagOther:
+        {
+            // we only write plain values this way. Containers would be read without
+            // any of the checks above, QDataStream reserves whatever count they claim
+            const QByteArray type = m_in.device()->peek( sizeof( quint32 ) );
+            if ( type.size() < (int)sizeof( quint32 ) )
+                break;
+
+            const quint32 typeId = qFromBigEndian< quint32 >( (const uchar*)type.constData() );
+            if ( typeId == QVariant::List || typeId == QVariant::Map || typeId == QVariant::StringList ||
+                 typeId == QVariant::Hash || typeId >= QVariant::UserType )
+                break;
+
+            QVariant v;
+            m_in >> v;
+            return v;
+        }
+
+        default:
+            break;
+    }
+
+    m_in.setStatus( QDataStream::ReadCorruptData );
+    return QVariant();
+}
+
+
+QByteArray
+OpCodec::encode( const QVariantMap& op )
+{
+    QByteArray body;
+    QDataStream bodyStream( &body, QIODevice::WriteOnly );
+    bodyStream.setVersion( QDataStream::Qt_4_7 );
+
+    Writer writer( bodyStream );
+    writer.write( op );
+
+    QByteArray data;
+    QDataStream out( &data, QIODevice::WriteOnly );
+    out.setVersion( QDataStream::Qt_4_7 );
+    out << (quint8)OPCODEC_VERSION << writer.strings();
+    data.append( body );
+
+    return data;
+}
+
+
+QVariantMap
+OpCodec::decode( const QByteArray& data, bool* ok )
+{
+    QDataStream in( data );
+    in.setVersion( QDataStream::Qt_4_7 );
+
+    quint8 version;
+    in >> version;
+    if ( version != OPCODEC_VERSION )
+    {
+        tLog() << "Unknown oplog encoding version:" << version;
+        if ( ok )
+            *ok = false;
+        return QVariantMap();
+    }
+
+    // not in >> strings, that reserves whatever count the peer claims
+    quint32 count;
+    in >> count;
+
+    QStringList strings;
+    if ( Reader::fits( in, count, 4 ) )
+    {
+        for ( quint32 i = 0; i < count && in.status() == QDataStream::Ok; i++ )
+        {
+            QString s;
+            in >> s;
+            strings << s;
+        }
+    }
+
+    Reader reader( in, strings );
+    const QVariant op = reader.read();
+
+    if ( ok )
+        *ok = ( in.status() == QDataStream::Ok && op.type() == QVariant::Map );
+
+    return op.toMap();
+}
+
+
+QVariantMap
+OpCodec::fromPayload( const QByteArray& payload, bool compressed, bool binary )
+{
+    const QByteArray data = compressed ? qUncompress( payload ) : payload;
+    if ( binary )
+        return decode( data );
+
+    QJson::Parser parser;
+    return parser.parse( data ).toMap();
+}
+
+
+QByteArray
+OpCodec::toJson( const QByteArray& data, bool compressed )
+{
+    QJson::Serializer serializer;
+    return serializer.serialize( decode( compressed ? qUncompress( data ) : data ) );
+}
@@ -0,0 +1,48 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Copyright 2010-2011, Christian Muehlhaeuser <muesli@tomahawk-player.org>
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef OPCODEC_H
+#define OPCODEC_H
+
+#include <QByteArray>
+#include <QVariantMap>
+
+#include "dllmacro.h"
+
+/**
+  Compact binary encoding for oplog entries, used instead of JSON in the oplog
+  and between peers that support it.
+
+  Strings are stored once in a table and referenced by index, values keep their
+  type, and lists of maps sharing the same keys (e.g. the files of an addfiles op)
+  are written as a table with the keys only once.
+  */
+class DLLEXPORT OpCodec
+{
+public:
+    static QByteArray encode( const QVariantMap& op );
+    static QVariantMap decode( const QByteArray& data, bool* ok = 0 );
+
+    // decodes an op as stored in the oplog, in either encoding
+    static QVariantMap fromPayload( const QByteArray& payload, bool compressed, bool binary );
+
+    // converts a (possibly compressed) binary op to the JSON old peers expect
+    static QByteArray toJson( const QByteArray& data, bool compressed );
+};
+
+#endif // OPCODEC_H
@@ -9,11 +9,22 @@ CREATE TABLE IF NOT EXISTS oplog (
     command TEXT NOT NULL,
     singleton BOOLEAN NOT NULL,
     compressed BOOLEAN NOT NULL,
-    json TEXT NOT NULL
+    json TEXT NOT NULL,
+    binary BOOLEAN NOT NULL DEFAULT 0     -- json holds an OpCodec encoded op instead of JSON
 );
 CREATE UNIQUE INDEX oplog_guid ON oplog(guid);
 CREATE INDEX oplog_source ON oplog(source);
 
+-- Our own addfiles/deletefiles ops up to 'cutoff' folded into a single addfiles op.
+-- The folded oplog rows are kept as 'compacted' stubs, so peers can still refer to their guids.
+
+CREATE TABLE IF NOT EXISTS oplog_snapshot (
+    cutoff INTEGER NOT NULL,              -- id of the last folded oplog row
+    guid TEXT NOT NULL,                   -- guid of the last folded oplog row
+    compressed BOOLEAN NOT NULL,
+    json TEXT NOT NULL                    -- OpCodec encoded
+);
+
 
 
 -- the basic 3 catalogue tables:
@@ -94,7 +105,7 @@ CREATE INDEX playlist_item_playlist ON playlist_item(playlist);
 CREATE TABLE IF NOT EXISTS playlist_revision (
     guid TEXT PRIMARY KEY,
     playlist TEXT NOT NULL REFERENCES playlist(guid) ON DELETE CASCADE ON UPDATE CASCADE DEFERRABLE INITIALLY DEFERRED,
-    entries TEXT, -- qlist( guid, guid... )
+    entries TEXT, -- qlist( guid, guid... ), or a delta to previous_revision: { prefix, suffix, insert }
     author INTEGER REFERENCES source(id) ON DELETE CASCADE ON UPDATE CASCADE DEFERRABLE INITIALLY DEFERRED,
     timestamp INTEGER NOT NULL DEFAULT 0,
     previous_revision TEXT REFERENCES playlist_revision(guid) DEFERRABLE INITIALLY DEFERRED
@@ -295,4 +306,4 @@ CREATE TABLE IF NOT EXISTS settings (
     v TEXT NOT NULL DEFAULT ''
 );
 
-INSERT INTO settings(k,v) VALUES('schema_version', '28');
+INSERT INTO settings(k,v) VALUES('schema_version', '30');
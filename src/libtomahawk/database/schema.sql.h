@@ -1,5 +1,5 @@
 /*
-    This file was automatically generated from ./schema.sql on Fri Nov 18 14:00:37 CET 2011.
+    This file was automatically generated from ./schema.sql on Sun Oct 18 13:40:52 UTC 2026.
 */
 
 static const char * tomahawk_schema_sql = 
@@ -10,10 +10,17 @@ static const char * tomahawk_schema_sql =
 "    command TEXT NOT NULL,"
 "    singleton BOOLEAN NOT NULL,"
 "    compressed BOOLEAN NOT NULL,"
-"    json TEXT NOT NULL"
+"    json TEXT NOT NULL,"
+"    binary BOOLEAN NOT NULL DEFAULT 0     "
 ");"
 "CREATE UNIQUE INDEX oplog_guid ON oplog(guid);"
 "CREATE INDEX oplog_source ON oplog(source);"
+"CREATE TABLE IF NOT EXISTS oplog_snapshot ("
+"    cutoff INTEGER NOT NULL,              "
+"    guid TEXT NOT NULL,                   "
+"    compressed BOOLEAN NOT NULL,"
+"    json TEXT NOT NULL                    "
+");"
 "CREATE TABLE IF NOT EXISTS artist ("
 "    id INTEGER PRIMARY KEY AUTOINCREMENT,"
 "    name TEXT NOT NULL,"
@@ -107,6 +114,7 @@ static const char * tomahawk_schema_sql =
 ");"
 "CREATE UNIQUE INDEX file_url_src_uniq ON file(source, url);"
 "CREATE INDEX file_source ON file(source);"
+"CREATE INDEX file_mtime ON file(mtime);"
 "CREATE TABLE IF NOT EXISTS dirs_scanned ("
 "    name TEXT PRIMARY KEY,"
 "    mtime INTEGER NOT NULL"
@@ -191,7 +199,7 @@ static const char * tomahawk_schema_sql =
 "    k TEXT NOT NULL PRIMARY KEY,"
 "    v TEXT NOT NULL DEFAULT ''"
 ");"
-"INSERT INTO settings(k,v) VALUES('schema_version', '28');"
+"INSERT INTO settings(k,v) VALUES('schema_version', '30');"
     ;
 
 const char * get_tomahawk_sql()
@@ -21,6 +21,8 @@
 #include <QDir>
 #include <QSettings>
 #include <QNetworkConfiguration>
+#include <QNetworkConfigurationManager>
+#include <QTimer>
 #include <QDomElement>
 
 #include "album.h"
@@ -32,15 +34,20 @@
 
 #include <lastfm/ws.h>
 #include <lastfm/XmlQuery>
+#include <lastfm/ScrobbleCache>
 
 #include <qjson/parser.h>
 
+#define SCROBBLE_RETRY_MIN 60 * 1000
+#define SCROBBLE_RETRY_MAX 60 * 60 * 1000
+
 using namespace Tomahawk::InfoSystem;
 
 
 LastFmPlugin::LastFmPlugin()
     : InfoPlugin()
     , m_scrobbler( 0 )
+    , m_retryInterval( SCROBBLE_RETRY_MIN )
 {
     m_supportedGetTypes << InfoAlbumCoverArt << InfoArtistImages << InfoArtistSimilars << InfoArtistSongs << InfoChart << InfoChartCapabilities;
     m_supportedPushTypes << InfoSubmitScrobble << InfoSubmitNowPlaying << InfoLove << InfoUnLove;
@@ -69,6 +76,14 @@ LastFmPlugin::LastFmPlugin()
 
     m_badUrls << QUrl( "http://cdn.last.fm/flatness/catalogue/noimage" );
 
+    m_retryTimer = new QTimer( this );
+    m_retryTimer->setSingleShot( true );
+    connect( m_retryTimer, SIGNAL( timeout() ), SLOT( retryScrobbles() ) );
+
+    // drain the cache as soon as we're back online
+    m_netConfigManager = new QNetworkConfigurationManager( this );
+    connect( m_netConfigManager, SIGNAL( onlineStateChanged( bool ) ), SLOT( onOnlineStateChanged( bool ) ) );
+
     connect( TomahawkSettings::instance(), SIGNAL( changed() ),
                                              SLOT( settingsChanged() ), Qt::QueuedConnection );
 
@@ -79,6 +94,7 @@ LastFmPlugin::LastFmPlugin()
 LastFmPlugin::~LastFmPlugin()
 {
     qDebug() << Q_FUNC_INFO;
+
     delete m_scrobbler;
     m_scrobbler = 0;
 }
@@ -154,11 +170,9 @@ LastFmPlugin::pushInfo( const QString caller, const Tomahawk::InfoSystem::InfoTy
 void
 LastFmPlugin::nowPlaying( const QVariant &input )
 {
-    if ( !input.canConvert< Tomahawk::InfoSystem::InfoStringHash >() || !m_scrobbler )
+    if ( !input.canConvert< Tomahawk::InfoSystem::InfoStringHash >() )
     {
-        tLog() << "LastFmPlugin::nowPlaying no m_scrobbler, or cannot convert input!";
-        if ( !m_scrobbler )
-            tLog() << "No scrobbler!";
+        tLog() << "LastFmPlugin::nowPlaying cannot convert input!";
         return;
     }
 
@@ -176,18 +190,76 @@ LastFmPlugin::nowPlaying( const QVariant &input )
     m_track.setDuration( hash["duration"].toUInt( &ok ) );
     m_track.setSource( lastfm::Track::Player );
 
-    m_scrobbler->nowPlaying( m_track );
+    // without a scrobbler yet we still remember the track, so scrobble() can cache it
+    if ( m_scrobbler )
+        m_scrobbler->nowPlaying( m_track );
 }
 
 
 void
 LastFmPlugin::scrobble()
 {
-    if ( !m_scrobbler || m_track.isNull() )
+    if ( m_track.isNull() || !TomahawkSettings::instance()->scrobblingEnabled() )
+        return;
+
+    if ( !m_scrobbler )
+    {
+        // still authenticating. The scrobbler submits the disk cache once it's up
+        if ( lastfm::ws::Username.isEmpty() )
+            return;
+
+        tLog() << Q_FUNC_INFO << "Caching scrobble until we're logged in:" << m_track.toString();
+        ScrobbleCache( lastfm::ws::Username ).add( QList<lastfm::Track>() << m_track );
         return;
+    }
 
+    // goes to the disk cache right away, then gets submitted with whatever else is
+    // in there. The scrobbler sends up to 50 per request and skips if one is in flight
     tLog() << Q_FUNC_INFO << "Scrobbling now:" << m_track.toString();
     m_scrobbler->cache( m_track );
+
+    if ( !m_retryTimer->isActive() )
+        m_retryTimer->start( m_retryInterval );
+}
+
+
+void
+LastFmPlugin::retryScrobbles()
+{
+    if ( !m_scrobbler )
+        return;
+
+    // the scrobbler doesn't tell us about failed submissions, but it only keeps what wasn't accepted
+    if ( ScrobbleCache( lastfm::ws::Username ).tracks().isEmpty() )
+    {
+        m_retryInterval = SCROBBLE_RETRY_MIN;
+        return;
+    }
+
+    m_retryInterval = qMin( m_retryInterval * 2, SCROBBLE_RETRY_MAX );
+    tLog() << Q_FUNC_INFO << "Retrying cached scrobbles, next attempt in" << m_retryInterval / 1000 << "seconds";
+
+    m_scrobbler->submit();
+    m_retryTimer->start( m_retryInterval );
+}
+
+
+void
+LastFmPlugin::onScrobblesSubmitted()
+{
+    // got through, the scrobbler carries on with the rest of its cache by itself
+    m_retryInterval = SCROBBLE_RETRY_MIN;
+    m_retryTimer->start( m_retryInterval );
+}
+
+
+void
+LastFmPlugin::onOnlineStateChanged( bool online )
+{
+    if ( !online || !m_scrobbler )
+        return;
+
+    m_retryInterval = SCROBBLE_RETRY_MIN;
     m_scrobbler->submit();
 }
 
@@ -704,6 +776,7 @@ LastFmPlugin::settingsChanged()
     {
         delete m_scrobbler;
         m_scrobbler = 0;
+        m_retryTimer->stop();
     }
     else if ( TomahawkSettings::instance()->lastFmUsername() != lastfm::ws::Username ||
                TomahawkSettings::instance()->lastFmPassword() != m_pw )
@@ -749,7 +822,7 @@ LastFmPlugin::onAuthenticated()
 
 //            qDebug() << "Got session key from last.fm";
             if ( TomahawkSettings::instance()->scrobblingEnabled() )
-                m_scrobbler = new lastfm::Audioscrobbler( "thk" );
+                initScrobbler();
         }
     }
     else
@@ -782,11 +855,23 @@ LastFmPlugin::createScrobbler()
         qDebug() << "LastFmPlugin::createScrobbler Already have session key";
         lastfm::ws::SessionKey = TomahawkSettings::instance()->lastFmSessionKey();
 
-        m_scrobbler = new lastfm::Audioscrobbler( "thk" );
+        initScrobbler();
     }
 }
 
 
+void
+LastFmPlugin::initScrobbler()
+{
+    // submits whatever is left in the disk cache from last time
+    m_scrobbler = new lastfm::Audioscrobbler( "thk" );
+    connect( m_scrobbler, SIGNAL( scrobblesSubmitted( QList<lastfm::Track> ) ), SLOT( onScrobblesSubmitted() ) );
+
+    m_retryInterval = SCROBBLE_RETRY_MIN;
+    m_retryTimer->start( m_retryInterval );
+}
+
+
 QList<lastfm::Track>
 LastFmPlugin::parseTrackList( QNetworkReply* reply )
 {
@@ -28,6 +28,8 @@
 #include <QObject>
 
 class QNetworkReply;
+class QNetworkConfigurationManager;
+class QTimer;
 
 namespace Tomahawk
 {
@@ -53,6 +55,10 @@ public slots:
     void topTracksReturned();
     void chartReturned();
 
+    void retryScrobbles();
+    void onScrobblesSubmitted();
+    void onOnlineStateChanged( bool online );
+
 protected slots:
     virtual void getInfo( Tomahawk::InfoSystem::InfoRequestData requestData );
     virtual void notInCacheSlot( Tomahawk::InfoSystem::InfoStringHash criteria, Tomahawk::InfoSystem::InfoRequestData requestData );
@@ -68,6 +74,7 @@ private:
     void fetchChartCapabilities( Tomahawk::InfoSystem::InfoRequestData requestData );
 
     void createScrobbler();
+    void initScrobbler();
     void nowPlaying( const QVariant &input );
     void scrobble();
     void sendLoveSong( const InfoType type, QVariant input );
@@ -80,6 +87,10 @@ private:
     lastfm::Audioscrobbler* m_scrobbler;
     QString m_pw;
 
+    QTimer* m_retryTimer;
+    int m_retryInterval;
+    QNetworkConfigurationManager* m_netConfigManager;
+
     QList< QUrl > m_badUrls;
 };
 
@@ -27,16 +27,19 @@
 #include "source.h"
 #include "artist.h"
 
-TransferStatusItem::TransferStatusItem( TransferStatusManager* p, StreamConnection* sc )
+TransferStatusItem::TransferStatusItem( TransferStatusManager* p, StreamConnection* sc, const Tomahawk::result_ptr& track, const Tomahawk::source_ptr& source, bool receiving )
     : m_parent( p )
-    , m_stream( QWeakPointer< StreamConnection >( sc ) )
+    , m_stream( sc )
+    , m_track( track )
+    , m_source( source )
+    , m_transferRate( 0 )
 {
-    if ( m_stream.data()->type() == StreamConnection::RECEIVING )
+    if ( receiving )
         m_type = "receive";
     else
         m_type = "send";
 
-    connect( m_stream.data(), SIGNAL( updated() ), SLOT( onTransferUpdate() ) );
+    connect( Servent::instance(), SIGNAL( streamUpdated( StreamConnection*, qint64 ) ), SLOT( onTransferUpdate( StreamConnection*, qint64 ) ) );
     connect( Servent::instance(), SIGNAL( streamFinished( StreamConnection* ) ), SLOT( streamFinished( StreamConnection* ) ) );
 }
 
@@ -48,15 +51,12 @@ TransferStatusItem::~TransferStatusItem()
 QString
 TransferStatusItem::mainText() const
 {
-    if ( m_stream.isNull() )
-        return QString();
-
-    if ( m_stream.data()->source().isNull() && !m_stream.data()->track().isNull() )
-        return QString( "%1" ).arg( QString( "%1 - %2" ).arg( m_stream.data()->track()->artist()->name() ).arg( m_stream.data()->track()->track() ) );
-    else if ( !m_stream.data()->source().isNull() && !m_stream.data()->track().isNull() )
-        return QString( "%1 %2 %3" ).arg( QString( "%1 - %2" ).arg( m_stream.data()->track()->artist()->name() ).arg( m_stream.data()->track()->track() ) )
-                                .arg( m_stream.data()->type() == StreamConnection::RECEIVING ? tr( "from" ) : tr( "to" ) )
-                                .arg( m_stream.data()->source()->friendlyName() );
+    if ( m_source.isNull() && !m_track.isNull() )
+        return QString( "%1" ).arg( QString( "%1 - %2" ).arg( m_track->artist()->name() ).arg( m_track->track() ) );
+    else if ( !m_source.isNull() && !m_track.isNull() )
+        return QString( "%1 %2 %3" ).arg( QString( "%1 - %2" ).arg( m_track->artist()->name() ).arg( m_track->track() ) )
+                                .arg( m_type == "receive" ? tr( "from" ) : tr( "to" ) )
+                                .arg( m_source->friendlyName() );
     else
         return QString();
 }
@@ -64,26 +64,20 @@ TransferStatusItem::mainText() const
 QString
 TransferStatusItem::rightColumnText() const
 {
-    if ( m_stream.isNull() )
-        return QString();
-
-    return QString( "%1 kb/s" ).arg( m_stream.data()->transferRate() / 1024 );
+    return QString( "%1 kb/s" ).arg( m_transferRate / 1024 );
 }
 
 void
 TransferStatusItem::streamFinished( StreamConnection* sc )
 {
-    if ( m_stream.data() == sc )
+    if ( m_stream == sc )
         emit finished();
 }
 
 QPixmap
 TransferStatusItem::icon() const
 {
-    if ( m_stream.isNull() )
-        return QPixmap();
-
-    if ( m_stream.data()->type() == StreamConnection::SENDING )
+    if ( m_type == "send" )
         return m_parent->rxPixmap();
    else
        return m_parent->txPixmap();
@@ -91,8 +85,12 @@ TransferStatusItem::icon() const
 
 
 void
-TransferStatusItem::onTransferUpdate()
+TransferStatusItem::onTransferUpdate( StreamConnection* sc, qint64 transferRate )
 {
+    if ( m_stream != sc )
+        return;
+
+    m_transferRate = transferRate;
     emit statusChanged();
 }
 
@@ -103,11 +101,12 @@ TransferStatusManager::TransferStatusManager( QObject* parent )
     m_rxPixmap.load( RESPATH "images/uploading.png" );
     m_txPixmap.load( RESPATH "images/downloading.png" );
 
-    connect( Servent::instance(), SIGNAL( streamStarted( StreamConnection* ) ), SLOT( streamRegistered( StreamConnection* ) ) );
+    connect( Servent::instance(), SIGNAL( streamStarted( StreamConnection*, Tomahawk::result_ptr, Tomahawk::source_ptr, bool ) ),
+                                    SLOT( streamRegistered( StreamConnection*, Tomahawk::result_ptr, Tomahawk::source_ptr, bool ) ) );
 }
 
 void
-TransferStatusManager::streamRegistered( StreamConnection* sc )
+TransferStatusManager::streamRegistered( StreamConnection* sc, const Tomahawk::result_ptr& track, const Tomahawk::source_ptr& source, bool receiving )
 {
-    JobStatusView::instance()->model()->addJob( new TransferStatusItem( this, sc ) );
+    JobStatusView::instance()->model()->addJob( new TransferStatusItem( this, sc, track, source, receiving ) );
 }
@@ -20,6 +20,7 @@
 #define TRANSFERSTATUSITEM_H
 
 #include "JobStatusItem.h"
+#include "typedefs.h"
 
 class StreamConnection;
 
@@ -34,7 +35,7 @@ public:
     QPixmap txPixmap() const { return m_txPixmap; }
 
 private slots:
-    void streamRegistered( StreamConnection* sc );
+    void streamRegistered( StreamConnection* sc, const Tomahawk::result_ptr& track, const Tomahawk::source_ptr& source, bool receiving );
 
 private:
     QPixmap m_rxPixmap, m_txPixmap;
@@ -44,7 +45,7 @@ class TransferStatusItem : public JobStatusItem
 {
     Q_OBJECT
 public:
-    explicit TransferStatusItem( TransferStatusManager* p, StreamConnection* );
+    explicit TransferStatusItem( TransferStatusManager* p, StreamConnection* sc, const Tomahawk::result_ptr& track, const Tomahawk::source_ptr& source, bool receiving );
     virtual ~TransferStatusItem();
 
     virtual QString rightColumnText() const;
@@ -54,12 +55,17 @@ public:
 
 private slots:
     void streamFinished( StreamConnection* sc );
-    void onTransferUpdate();
+    void onTransferUpdate( StreamConnection* sc, qint64 transferRate );
 
 private:
     TransferStatusManager* m_parent;
     QString m_type, m_main, m_right;
-    QWeakPointer< StreamConnection > m_stream;
+
+    // only compared against, the stream lives and dies in a network thread
+    StreamConnection* m_stream;
+    Tomahawk::result_ptr m_track;
+    Tomahawk::source_ptr m_source;
+    qint64 m_transferRate;
 };
 
 #endif // TRANSFERSTATUSITEM_H
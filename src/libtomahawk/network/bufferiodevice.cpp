@@ -29,9 +29,11 @@
 
 BufferIODevice::BufferIODevice( unsigned int size, QObject* parent )
     : QIODevice( parent )
+    , m_mut( QMutex::Recursive )
     , m_size( size )
     , m_received( 0 )
     , m_pos( 0 )
+    , m_complete( false )
 {
 }
 
@@ -61,16 +63,23 @@ BufferIODevice::close()
 bool
 BufferIODevice::seek( qint64 pos )
 {
-    qDebug() << Q_FUNC_INFO << pos << m_size;
+    int block;
+    bool empty;
+    {
+        QMutexLocker lock( &m_mut );
+        qDebug() << Q_FUNC_INFO << pos << m_size;
 
-    if ( pos >= m_size )
-        return false;
+        if ( pos >= m_size )
+            return false;
 
-    int block = blockForPos( pos );
-    if ( isBlockEmpty( block ) )
+        block = blockForPos( pos );
+        empty = isBlockEmpty( block );
+        m_pos = pos;
+    }
+
+    if ( empty )
         emit blockRequest( block );
 
-    m_pos = pos;
     qDebug() << "Finished seeking";
 
     return true;
@@ -88,8 +97,19 @@ void
 BufferIODevice::inputComplete( const QString& errmsg )
 {
     qDebug() << Q_FUNC_INFO;
+
+    {
+        QMutexLocker lock( &m_mut );
+
+        // several connections may be feeding us, only the first one to finish counts
+        if ( m_complete )
+            return;
+
+        m_complete = true;
+        m_size = m_received;
+    }
+
     setErrorString( errmsg );
-    m_size = m_received;
     emit readChannelFinished();
 }
 
@@ -97,25 +117,28 @@ BufferIODevice::inputComplete( const QString& errmsg )
 void
 BufferIODevice::addData( int block, const QByteArray& ba )
 {
+    int gap = -1;
     {
         QMutexLocker lock( &m_mut );
 
         while ( m_buffer.count() <= block )
             m_buffer << QByteArray();
 
+        // with several peers feeding us, blocks may arrive more than once
+        if ( !m_buffer.at( block ).isEmpty() )
+            return;
+
         m_buffer.replace( block, ba );
-    }
+        m_received += ba.count();
 
-    // If this was the last block of the transfer, check if we need to fill up gaps
-    if ( block + 1 == maxBlocks() )
-    {
-        if ( nextEmptyBlock() >= 0 )
-        {
-            emit blockRequest( nextEmptyBlock() );
-        }
+        // If this was the last block of the transfer, check if we need to fill up gaps
+        if ( block + 1 == maxBlocks() )
+            gap = nextEmptyBlock();
     }
 
-    m_received += ba.count();
+    if ( gap >= 0 )
+        emit blockRequest( gap );
+
     emit bytesWritten( ba.count() );
     emit readyRead();
 }
@@ -124,15 +147,25 @@ BufferIODevice::addData( int block, const QByteArray& ba )
 qint64
 BufferIODevice::bytesAvailable() const
 {
+    QMutexLocker lock( &m_mut );
     return m_size - m_pos;
 }
 
 
+qint64
+BufferIODevice::pos() const
+{
+    QMutexLocker lock( &m_mut );
+    return m_pos;
+}
+
+
 qint64
 BufferIODevice::readData( char* data, qint64 maxSize )
 {
 //    qDebug() << Q_FUNC_INFO << m_pos << maxSize << 1;
 
+    QMutexLocker lock( &m_mut );
     if ( atEnd() )
         return 0;
 
@@ -161,6 +194,7 @@ BufferIODevice::writeData( const char* data, qint64 maxSize )
 qint64
 BufferIODevice::size() const
 {
+    QMutexLocker lock( &m_mut );
     qDebug() << Q_FUNC_INFO << m_size;
     return m_size;
 }
@@ -169,6 +203,7 @@ BufferIODevice::size() const
 bool
 BufferIODevice::atEnd() const
 {
+    QMutexLocker lock( &m_mut );
 //    qDebug() << Q_FUNC_INFO << ( m_size <= m_pos );
     return ( m_size <= m_pos );
 }
@@ -181,6 +216,7 @@ BufferIODevice::clear()
 
     m_pos = 0;
     m_buffer.clear();
+    m_received = 0;
 }
 
 
@@ -216,6 +252,8 @@ BufferIODevice::offsetForPos( qint64 pos ) const
 int
 BufferIODevice::nextEmptyBlock() const
 {
+    QMutexLocker lock( &m_mut );
+
     int i = 0;
     foreach( const QByteArray& ba, m_buffer )
     {
@@ -232,9 +270,44 @@ BufferIODevice::nextEmptyBlock() const
 }
 
 
+// returns the block in the middle of the largest stretch of missing blocks, or -1
+int
+BufferIODevice::splitBlock() const
+{
+    QMutexLocker lock( &m_mut );
+
+    const int max = maxBlocks();
+    int start = -1, bestStart = -1, bestLength = 0;
+
+    for ( int i = 0; i <= max; i++ )
+    {
+        if ( i < max && isBlockEmpty( i ) )
+        {
+            if ( start < 0 )
+                start = i;
+            continue;
+        }
+
+        if ( start >= 0 && i - start > bestLength )
+        {
+            bestStart = start;
+            bestLength = i - start;
+        }
+        start = -1;
+    }
+
+    if ( bestStart < 0 )
+        return -1;
+
+    return bestStart + bestLength / 2;
+}
+
+
 int
 BufferIODevice::maxBlocks() const
 {
+    QMutexLocker lock( &m_mut );
+
     int i = m_size / BLOCKSIZE;
 
     if ( ( m_size % BLOCKSIZE ) > 0 )
@@ -247,6 +320,8 @@ BufferIODevice::maxBlocks() const
 bool
 BufferIODevice::isBlockEmpty( int block ) const
 {
+    QMutexLocker lock( &m_mut );
+
     if ( block >= m_buffer.count() )
         return true;
 
@@ -39,7 +39,7 @@ public:
     virtual qint64 bytesAvailable() const;
     virtual qint64 size() const;
     virtual bool atEnd() const;
-    virtual qint64 pos() const { return m_pos; }
+    virtual qint64 pos() const;
 
     void addData( int block, const QByteArray& ba );
     void clear();
@@ -54,6 +54,7 @@ public:
 
     int maxBlocks() const;
     int nextEmptyBlock() const;
+    int splitBlock() const;
     bool isBlockEmpty( int block ) const;
 
 signals:
@@ -68,11 +69,14 @@ private:
     int offsetForPos( qint64 pos ) const;
     QByteArray getData( qint64 pos, qint64 size );
 
+    // several stream connections in different threads may feed us at once,
+    // everything below is guarded by m_mut
     QList<QByteArray> m_buffer;
-    mutable QMutex m_mut; //const methods need to lock
+    mutable QMutex m_mut; //const methods need to lock, recursive as they call each other
     unsigned int m_size, m_received;
 
     unsigned int m_pos;
+    bool m_complete;
 };
 
 #endif // BUFFERIODEVICE_H
@@ -22,6 +22,7 @@
 #include <QtCore/QThread>
 
 #include "network/servent.h"
+#include "network/uploadscheduler.h"
 #include "utils/logger.h"
 
 #define PROTOVER "4" // must match remote peer, or we can't talk.
@@ -37,6 +38,7 @@ Connection::Connection( Servent* parent )
     , m_do_shutdown( false )
     , m_actually_shutting_down( false )
     , m_peer_disconnected( false )
+    , m_uploadScheduled( false )
     , m_tx_bytes( 0 )
     , m_tx_bytes_requested( 0 )
     , m_rx_bytes( 0 )
@@ -50,6 +52,10 @@ Connection::Connection( Servent* parent )
     moveToThread( m_servent->thread() );
     qDebug() << "CTOR Connection (super)" << thread();
 
+    // so they follow us when Servent hands us over to one of its network threads
+    m_msgprocessor_in.setParent( this );
+    m_msgprocessor_out.setParent( this );
+
     connect( &m_msgprocessor_out, SIGNAL( ready( msg_ptr ) ),
              SLOT( sendMsg_now( msg_ptr ) ), Qt::QueuedConnection );
 
@@ -204,18 +210,14 @@ Connection::doSetup()
     qDebug() << Q_FUNC_INFO << thread();
     /*
         New connections can be created from other thread contexts, such as
-        when AudioEngine calls getIODevice.. - we need to ensure that connections
-        and their associated sockets are running in the same thread as the servent.
+        when AudioEngine calls getIODevice.. - the constructor moves them to the
+        servent's thread, and Servent::handoverSocket() may move them on to one
+        of its network threads together with their socket. Either way we are
+        running in our own thread by now.
 
         HINT: export QT_FATAL_WARNINGS=1 helps to catch these kind of errors.
      */
-    if( QThread::currentThread() != m_servent->thread() )
-    {
-        // Connections should always be in the same thread as the servent.
-        qDebug() << "Fixing thead affinity...";
-        moveToThread( m_servent->thread() );
-        qDebug() << Q_FUNC_INFO  << thread();
-    }
+    Q_ASSERT( QThread::currentThread() == thread() );
 
     //stats timer calculates BW used by this connection
     m_statstimer = new QTimer;
@@ -439,6 +441,9 @@ Connection::sendMsg_now( msg_ptr msg )
         shutdown( false );
         return;
     }
+
+    if ( !m_uploadScheduled )
+        UploadScheduler::instance()->consumed( msg->length() + Msg::headerSize() );
 }
 
 
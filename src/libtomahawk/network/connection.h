@@ -87,6 +87,9 @@ public:
     void setMsgProcessorModeOut( quint32 m ) { m_msgprocessor_out.setMode( m ); }
     void setMsgProcessorModeIn( quint32 m ) { m_msgprocessor_in.setMode( m ); }
 
+    /// msgs of scheduled connections are paced by the UploadScheduler, everybody else's go out first
+    void setUploadScheduled( bool b ) { m_uploadScheduled = b; }
+
     const QHostAddress peerIpAddress() const { return m_peerIpAddress; }
 
 signals:
@@ -136,6 +139,7 @@ private:
     void handleReadMsg();
     void actualShutdown();
     bool m_do_shutdown, m_actually_shutting_down, m_peer_disconnected;
+    bool m_uploadScheduled;
     qint64 m_tx_bytes, m_tx_bytes_requested;
     qint64 m_rx_bytes;
     QString m_id;
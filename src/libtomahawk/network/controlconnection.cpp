@@ -143,6 +143,41 @@ ControlConnection::setup()
     connect( m_pingtimer, SIGNAL( timeout() ), SLOT( onPingTimer() ) );
     m_pingtimer->start();
     m_pingtimer_mark.start();
+
+    sendFeatures();
+}
+
+
+void
+ControlConnection::sendFeatures()
+{
+    QVariantMap m;
+    m.insert( "method", "features" );
+    // we can take "block" requests on a stream before we opened its file
+    m.insert( "streamblocks", true );
+    // we can read msgs compressed with MsgProcessor's preset dictionary
+    if ( MsgProcessor::dictionarySupported() )
+        m.insert( "zlibdict1", true );
+
+    sendMsg( m );
+}
+
+
+bool
+ControlConnection::peerSupports( const QString& feature ) const
+{
+    QMutexLocker lock( &m_featuresMutex );
+    return m_peerFeatures.value( feature ).toBool();
+}
+
+
+quint32
+ControlConnection::outgoingMsgMode() const
+{
+    if ( MsgProcessor::dictionarySupported() && peerSupports( "zlibdict1" ) )
+        return MsgProcessor::COMPRESS_IF_LARGE | MsgProcessor::COMPRESS_WITH_DICTIONARY;
+
+    return MsgProcessor::COMPRESS_IF_LARGE;
 }
 
 
@@ -249,12 +284,6 @@ ControlConnection::handleMsg( msg_ptr msg )
         return;
     }
 
-    // if small and not compresed, print it out for debug
-    if( msg->length() < 1024 && !msg->is( Msg::COMPRESSED ) )
-    {
-        qDebug() << id() << "got msg:" << QString::fromAscii( msg->payload() );
-    }
-
     // All control connection msgs are JSON
     if( !msg->is( Msg::JSON ) )
     {
@@ -263,6 +292,12 @@ ControlConnection::handleMsg( msg_ptr msg )
         return;
     }
 
+    // if small, print it out for debug
+    if( msg->length() < 1024 )
+    {
+        qDebug() << id() << "got msg:" << msg->json();
+    }
+
     QVariantMap m = msg->json().toMap();
     if( !m.isEmpty() )
     {
@@ -278,6 +313,18 @@ ControlConnection::handleMsg( msg_ptr msg )
             m_dbconnkey = m.value( "key" ).toString() ;
             setupDbSyncConnection();
         }
+        else if( m.value( "method" ).toString() == "features" )
+        {
+            {
+                QMutexLocker lock( &m_featuresMutex );
+                m_peerFeatures = m;
+            }
+
+            // our dbsync connection may have been set up before this arrived
+            setMsgProcessorModeOut( outgoingMsgMode() );
+            if ( m_dbsyncconn )
+                m_dbsyncconn->setMsgProcessorModeOut( outgoingMsgMode() );
+        }
         else if( m.value( "method" ) == "protovercheckfail" )
         {
             qDebug() << "*** Remote peer protocol version mismatch, connection closed";
@@ -286,13 +333,13 @@ ControlConnection::handleMsg( msg_ptr msg )
         }
         else
         {
-            qDebug() << id() << "Unhandled msg:" << QString::fromAscii( msg->payload() );
+            qDebug() << id() << "Unhandled msg:" << m;
         }
 
         return;
     }
 
-    qDebug() << id() << "Invalid msg:" << QString::fromAscii(msg->payload());
+    qDebug() << id() << "Invalid msg:" << msg->json();
 }
 
 
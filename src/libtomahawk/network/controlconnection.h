@@ -22,10 +22,15 @@
     They arrange connections/reverse connections, inform us
     when the peer goes offline, and own+setup DBSyncConnections.
 
+    Right after setup both ends announce the protocol extensions they
+    understand in a "features" msg. Older peers just log it as unhandled.
+
 */
 #ifndef CONTROLCONNECTION_H
 #define CONTROLCONNECTION_H
 
+#include <QMutex>
+
 #include "typedefs.h"
 #include "connection.h"
 
@@ -48,6 +53,12 @@ public:
 
     Tomahawk::source_ptr source() const;
 
+    // did the peer announce this feature? Safe to call from any thread
+    bool peerSupports( const QString& feature ) const;
+
+    // MsgProcessor mode for what we send this peer, on this and its dbsync connection
+    quint32 outgoingMsgMode() const;
+
 protected:
     virtual void setup();
 
@@ -61,6 +72,7 @@ private slots:
 
 private:
     void setupDbSyncConnection( bool ondemand = false );
+    void sendFeatures();
 
     Tomahawk::source_ptr m_source;
     DBSyncConnection* m_dbsyncconn;
@@ -70,6 +82,9 @@ private:
 
     QTimer* m_pingtimer;
     QTime m_pingtimer_mark;
+
+    QVariantMap m_peerFeatures;
+    mutable QMutex m_featuresMutex;
 };
 
 #endif // CONTROLCONNECTION_H
@@ -22,6 +22,11 @@
     Load the last GUID we applied for the peer, tell them it.
     In return, they send us all new ops since that guid.
 
+    Ops are sent in the binary OpCodec encoding if the peer said it
+    understands it ("binaryops" in fetchops), as JSON otherwise. Playlist
+    revisions only carry the changed entries, unless the peer didn't
+    announce "playlistdeltas".
+
     We then apply those new ops to our cache of their data
 
     Synced.
@@ -34,6 +39,8 @@
 #include "database/databasecommand.h"
 #include "database/databasecommand_collectionstats.h"
 #include "database/databasecommand_loadops.h"
+#include "database/opcodec.h"
+#include "network/controlconnection.h"
 #include "remotecollection.h"
 #include "source.h"
 #include "sourcelist.h"
@@ -57,7 +64,10 @@ DBSyncConnection::DBSyncConnection( Servent* s, const source_ptr& src )
     this->setMsgProcessorModeIn( MsgProcessor::PARSE_JSON | MsgProcessor::UNCOMPRESS_ALL );
 
     // msgs are stored compressed in the db, so not typically needed here, but doesnt hurt:
-    this->setMsgProcessorModeOut( MsgProcessor::COMPRESS_IF_LARGE );
+    if ( m_source->controlConnection() )
+        this->setMsgProcessorModeOut( m_source->controlConnection()->outgoingMsgMode() );
+    else
+        this->setMsgProcessorModeOut( MsgProcessor::COMPRESS_IF_LARGE );
 }
 
 
@@ -166,6 +176,8 @@ DBSyncConnection::fetchOpsData( const QString& sinceguid )
     QVariantMap msg;
     msg.insert( "method", "fetchops" );
     msg.insert( "lastop", sinceguid );
+    msg.insert( "binaryops", true );
+    msg.insert( "playlistdeltas", true );
     sendMsg( msg );
 }
 
@@ -194,9 +206,28 @@ DBSyncConnection::handleMsg( msg_ptr msg )
         return;
     }
 
-    Q_ASSERT( msg->is( Msg::JSON ) );
+    QVariantMap m;
+    if ( msg->is( Msg::JSON ) )
+    {
+        m = msg->json().toMap();
+    }
+    else if ( msg->is( Msg::DBOP ) )
+    {
+        bool ok;
+        m = OpCodec::decode( msg->payload(), &ok );
+        if ( !ok )
+        {
+            // half an op must never reach the db, but the rest of the batch still gets saved
+            tLog() << "Dropping corrupt op in dbsync" << m_source->id() << m_source->friendlyName();
+            if ( !msg->is( Msg::FRAGMENT ) )
+            {
+                changeState( SAVING );
+                m_source->executeCommands();
+            }
+            return;
+        }
+    }
 
-    QVariantMap m = msg->json().toMap();
     if ( m.empty() )
     {
         tLog() << "Failed to parse msg in dbsync" << m_source->id() << m_source->friendlyName();
@@ -236,7 +267,7 @@ DBSyncConnection::handleMsg( msg_ptr msg )
         return;
     }
 
-    tLog() << Q_FUNC_INFO << "Unhandled msg:" << msg->payload();
+    tLog() << Q_FUNC_INFO << "Unhandled msg:" << m;
     Q_ASSERT( false );
 }
 
@@ -259,6 +290,7 @@ DBSyncConnection::sendOps()
     source_ptr src = SourceList::instance()->getLocal();
 
     DatabaseCommand_loadOps* cmd = new DatabaseCommand_loadOps( src, m_uscache.value( "lastop" ).toString() );
+    cmd->setExpandDeltas( !m_uscache.value( "playlistdeltas" ).toBool() );
     connect( cmd, SIGNAL( done( QString, QString, QList< dbop_ptr > ) ),
                     SLOT( sendOpsData( QString, QString, QList< dbop_ptr > ) ) );
 
@@ -282,17 +314,33 @@ DBSyncConnection::sendOpsData( QString sinceguid, QString lastguid, QList< dbop_
 
     tLog( LOGVERBOSE ) << Q_FUNC_INFO << sinceguid << lastguid << "Num ops to send:" << ops.length();
 
+    const bool binaryOk = m_uscache.value( "binaryops" ).toBool();
+
     int i;
     for( i = 0; i < ops.length(); ++i )
     {
-        quint8 flags = Msg::JSON | Msg::DBOP;
+        const dbop_ptr& op = ops.at( i );
+        quint8 flags = Msg::DBOP;
+        QByteArray payload = op->payload;
+
+        if ( op->binary && !binaryOk )
+        {
+            // old peer, let the msgprocessor compress the JSON if it's big
+            payload = OpCodec::toJson( op->payload, op->compressed );
+            flags |= Msg::JSON;
+        }
+        else
+        {
+            if ( !op->binary )
+                flags |= Msg::JSON;
+            if ( op->compressed )
+                flags |= Msg::COMPRESSED;
+        }
 
-        if ( ops.at( i )->compressed )
-            flags |= Msg::COMPRESSED;
         if ( i != ops.length() - 1 )
             flags |= Msg::FRAGMENT;
 
-        sendMsg( Msg::factory( ops.at( i )->payload, flags ) );
+        sendMsg( Msg::factory( payload, flags ) );
     }
 }
 
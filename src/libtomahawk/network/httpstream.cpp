@@ -0,0 +1,194 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Copyright 2010-2011, Christian Muehlhaeuser <muesli@tomahawk-player.org>
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "httpstream.h"
+
+#include <QtNetwork/QNetworkReply>
+#include <QtNetwork/QNetworkRequest>
+
+#include "result.h"
+#include "bufferiodevice.h"
+#include "streamcache.h"
+#include "utils/tomahawkutils.h"
+#include "utils/logger.h"
+
+
+HttpStream::HttpStream( BufferIODevice* device, const Tomahawk::result_ptr& result, const QUrl& url )
+    : QObject( device )
+    , m_device( device )
+    , m_url( url )
+    , m_cacheKey( StreamCache::key( result ) )
+    , m_size( result->size() )
+    , m_block( 0 )
+    , m_firstBlock( 0 )
+    , m_checkedRange( false )
+{
+    // the device is read, sought and closed from phonon's thread
+    connect( m_device, SIGNAL( blockRequest( int ) ), SLOT( onBlockRequest( int ) ), Qt::QueuedConnection );
+    connect( m_device, SIGNAL( aboutToClose() ), SLOT( onDeviceClosed() ), Qt::QueuedConnection );
+
+    // whatever a previous, unfinished play left in the cache doesn't need fetching
+    if ( StreamCache::instance() )
+        StreamCache::instance()->fill( m_cacheKey, m_device );
+
+    const int block = m_device->nextEmptyBlock();
+    if ( block < 0 )
+        m_device->inputComplete();
+    else
+        fetch( block );
+}
+
+
+HttpStream::~HttpStream()
+{
+    abort();
+}
+
+
+void
+HttpStream::abort()
+{
+    if ( m_reply.isNull() )
+        return;
+
+    m_reply->disconnect( this );
+    m_reply->abort();
+    m_reply->deleteLater();
+    m_reply = 0;
+}
+
+
+void
+HttpStream::fetch( int block )
+{
+    abort();
+
+    m_block = block;
+    m_firstBlock = block;
+    m_checkedRange = false;
+    m_pending.clear();
+
+    QNetworkRequest req( m_url );
+    if ( block > 0 )
+        req.setRawHeader( "Range", QString( "bytes=%1-" ).arg( (qint64)block * BufferIODevice::blockSize() ).toAscii() );
+
+    tDebug( LOGVERBOSE ) << Q_FUNC_INFO << m_url << "from block" << block;
+
+    m_reply = TomahawkUtils::nam()->get( req );
+    connect( m_reply, SIGNAL( readyRead() ), SLOT( onReadyRead() ) );
+    connect( m_reply, SIGNAL( finished() ), SLOT( onFinished() ) );
+}
+
+
+void
+HttpStream::onBlockRequest( int block )
+{
+    // phonon seeked somewhere we don't have yet, unless we're about to get there anyway
+    if ( !m_device->isBlockEmpty( block ) )
+        return;
+    if ( !m_reply.isNull() && block == m_block )
+        return;
+
+    fetch( block );
+}
+
+
+void
+HttpStream::addBlock( const QByteArray& data )
+{
+    m_device->addData( m_block, data );
+    if ( StreamCache::instance() )
+        StreamCache::instance()->addBlock( m_cacheKey, m_size, m_block, data );
+
+    m_block++;
+}
+
+
+void
+HttpStream::onReadyRead()
+{
+    if ( !m_checkedRange )
+    {
+        // servers that ignore the range header send us the whole file again
+        m_checkedRange = true;
+        if ( m_block > 0 && m_reply->attribute( QNetworkRequest::HttpStatusCodeAttribute ).toInt() != 206 )
+        {
+            tDebug() << Q_FUNC_INFO << "Server doesn't support ranges, reading from the start:" << m_url;
+            m_block = 0;
+        }
+    }
+
+    m_pending += m_reply->readAll();
+
+    const int blockSize = BufferIODevice::blockSize();
+    while ( m_pending.size() >= blockSize )
+    {
+        addBlock( m_pending.left( blockSize ) );
+        m_pending.remove( 0, blockSize );
+    }
+
+    // ran into blocks we already have, skip ahead to the next gap
+    if ( m_block < m_device->maxBlocks() && !m_device->isBlockEmpty( m_block ) )
+    {
+        const int next = m_device->nextEmptyBlock();
+        if ( next < 0 )
+        {
+            abort();
+            m_device->inputComplete();
+        }
+        else
+            fetch( next );
+    }
+}
+
+
+void
+HttpStream::onFinished()
+{
+    if ( m_reply->error() != QNetworkReply::NoError )
+    {
+        tLog() << Q_FUNC_INFO << "Error streaming" << m_url << m_reply->errorString();
+        const QString error = m_reply->errorString();
+        abort();
+        m_device->inputComplete( error );
+        return;
+    }
+
+    // the last block of the file is the only short one
+    if ( !m_pending.isEmpty() )
+        addBlock( m_pending );
+    m_pending.clear();
+
+    const bool progressed = ( m_block != m_firstBlock );
+    abort();
+
+    // fill whatever gaps earlier seeks left behind. If the server stopped
+    // short of the size we were told, give up rather than asking again
+    const int next = m_device->nextEmptyBlock();
+    if ( next >= 0 && progressed )
+        fetch( next );
+    else
+        m_device->inputComplete();
+}
+
+
+void
+HttpStream::onDeviceClosed()
+{
+    abort();
+}
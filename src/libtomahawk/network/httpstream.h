@@ -0,0 +1,71 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Copyright 2010-2011, Christian Muehlhaeuser <muesli@tomahawk-player.org>
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef HTTPSTREAM_H
+#define HTTPSTREAM_H
+
+#include <QtCore/QObject>
+#include <QtCore/QPointer>
+#include <QtCore/QUrl>
+
+#include "typedefs.h"
+#include "dllmacro.h"
+
+class QNetworkReply;
+class BufferIODevice;
+
+/**
+ * Downloads a http result of known size block by block into a BufferIODevice,
+ * so phonon can seek in it, and writes every block to the StreamCache.
+ * Seeking to a block we don't have restarts the download there with a range
+ * request. Blocks already in the cache are never fetched again.
+ *
+ * Lives as a child of the device it feeds.
+ */
+class DLLEXPORT HttpStream : public QObject
+{
+Q_OBJECT
+
+public:
+    explicit HttpStream( BufferIODevice* device, const Tomahawk::result_ptr& result, const QUrl& url );
+    virtual ~HttpStream();
+
+private slots:
+    void fetch( int block );
+    void onBlockRequest( int block );
+    void onReadyRead();
+    void onFinished();
+    void onDeviceClosed();
+
+private:
+    void addBlock( const QByteArray& data );
+    void abort();
+
+    BufferIODevice* m_device;
+    QUrl m_url;
+    QString m_cacheKey;
+    unsigned int m_size;
+
+    QPointer<QNetworkReply> m_reply;
+    int m_block;
+    int m_firstBlock;
+    bool m_checkedRange;
+    QByteArray m_pending;
+};
+
+#endif // HTTPSTREAM_H
@@ -0,0 +1,112 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Copyright 2010-2011, Christian Muehlhaeuser <muesli@tomahawk-player.org>
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "msg.h"
+
+#include <QMutex>
+#include <QMutexLocker>
+
+// enough for a handful of streams in flight at once
+#define MAX_POOLED_FRAMES 32
+
+// small payloads get copied next to the header so the whole msg goes out in one write()
+#define MAX_COALESCED_PAYLOAD 4096
+
+static QMutex s_framePoolMutex;
+static QList< QByteArray > s_framePool;
+
+
+QByteArray
+Msg::frameBuffer( int payloadSize )
+{
+    QByteArray frame;
+    {
+        QMutexLocker l( &s_framePoolMutex );
+        if ( !s_framePool.isEmpty() )
+            frame = s_framePool.takeLast();
+    }
+
+    frame.resize( headerSize() + payloadSize );
+    return frame;
+}
+
+
+msg_ptr
+Msg::fromFrame( QByteArray& frame, char f )
+{
+    Q_ASSERT( frame.length() >= headerSize() );
+
+    msg_ptr msg( new Msg( QByteArray(), f ) );
+    msg->m_frame = frame;
+    msg->m_length = frame.length() - headerSize();
+    msg->m_pooled = true;
+
+    // drop the caller's reference first, so filling in the header doesn't detach the buffer
+    frame = QByteArray();
+
+    char* header = msg->m_frame.data();
+    qToBigEndian( msg->m_length, (uchar*)header );
+    header[ sizeof(quint32) ] = f;
+
+    return msg;
+}
+
+
+void
+Msg::recycleFrame( QByteArray& frame )
+{
+    QMutexLocker l( &s_framePoolMutex );
+    if ( s_framePool.count() < MAX_POOLED_FRAMES )
+        s_framePool << frame;
+}
+
+
+void
+Msg::setPayload( const QByteArray& ba )
+{
+    m_payload = ba;
+    m_length = ba.length();
+
+    if ( m_pooled )
+        recycleFrame( m_frame );
+    m_frame = QByteArray();
+    m_pooled = false;
+}
+
+
+bool
+Msg::write( QIODevice* device )
+{
+    if ( !m_frame.isNull() )
+        return device->write( m_frame ) == m_frame.length();
+
+    char buf[ sizeof(quint32) + sizeof(quint8) + MAX_COALESCED_PAYLOAD ];
+    qToBigEndian( m_length, (uchar*)buf );
+    buf[ sizeof(quint32) ] = m_flags;
+
+    if ( m_length <= MAX_COALESCED_PAYLOAD )
+    {
+        memcpy( buf + headerSize(), m_payload.constData(), m_length );
+        return device->write( buf, headerSize() + m_length ) == headerSize() + m_length;
+    }
+
+    // big payloads aren't worth copying just to save a call
+    if ( device->write( buf, headerSize() ) != headerSize() )
+        return false;
+    return device->write( m_payload ) == m_length;
+}
@@ -25,6 +25,10 @@
     Flags indicate if the payload is compressed/json/etc.
 
     Use static factory method to create, pass around shared pointers: msp_ptr
+
+    Bulk payloads (stream blocks) can be built straight into a pooled frame
+    buffer that has room for the header in front, see frameBuffer() and
+    fromFrame(), so they hit the wire with a single write and no extra copy.
 */
 
 #ifndef MSG_H
@@ -35,6 +39,8 @@
 #include <QtEndian>
 #include <QIODevice>
 
+#include "dllmacro.h"
+
 #include <qjson/parser.h>
 #include <qjson/serializer.h>
 #include <qjson/qobjecthelper.h>
@@ -42,7 +48,7 @@
 class Msg;
 typedef QSharedPointer<Msg> msg_ptr;
 
-class Msg
+class DLLEXPORT Msg
 {
     friend class MsgProcessor;
 
@@ -55,13 +61,15 @@ public:
         COMPRESSED = 8,
         DBOP = 16,
         PING = 32,
-        RESERVED_1 = 64,
+        DICTIONARY = 64, // COMPRESSED with MsgProcessor's preset dictionary, only sent to peers that asked for it
         SETUP = 128 // used to handshake/auth the connection prior to handing over to Connection subclass
     };
 
     virtual ~Msg()
     {
         //qDebug() << Q_FUNC_INFO;
+        if ( m_pooled )
+            recycleFrame( m_frame );
     }
 
     /// constructs new msg you wish to send
@@ -70,6 +78,14 @@ public:
         return msg_ptr( new Msg( ba, f ) );
     }
 
+    /// returns a (pooled) buffer with room for the header plus payloadSize bytes,
+    /// write the payload at data() + headerSize() and hand it to fromFrame()
+    static QByteArray frameBuffer( int payloadSize );
+
+    /// constructs new msg you wish to send from a buffer obtained with frameBuffer(),
+    /// takes over the buffer and leaves frame empty
+    static msg_ptr fromFrame( QByteArray& frame, char f );
+
     /// constructs an incomplete new msg that is missing the payload data
     static msg_ptr begin( char* headerToParse )
     {
@@ -88,15 +104,7 @@ public:
     }
 
     /// frames the msg and writes to the wire:
-    bool write( QIODevice * device )
-    {
-        quint32 size  = qToBigEndian( m_length );
-        quint8  flags = m_flags;
-        if( device->write( (const char*) &size,  sizeof(quint32) ) != sizeof(quint32) ) return false;
-        if( device->write( (const char*) &flags, sizeof(quint8) )  != sizeof(quint8)  ) return false;
-        if( device->write( (const char*) m_payload.data(), m_length ) != m_length ) return false;
-        return true;
-    }
+    bool write( QIODevice * device );
 
     // len(4) + flags(1)
     static quint8 headerSize() { return sizeof(quint32) + sizeof(quint8); }
@@ -105,9 +113,12 @@ public:
 
     bool is( Flag flag ) { return m_flags & flag; }
 
+    /// JSON msgs that went through MsgProcessor::PARSE_JSON only keep json()
     const QByteArray& payload() const
     {
         Q_ASSERT( m_incomplete == false );
+        if ( m_payload.isNull() && !m_frame.isNull() )
+            m_payload = m_frame.mid( headerSize() );
         return m_payload;
     }
 
@@ -135,7 +146,8 @@ private:
             m_length( ba.length() ),
             m_flags( f ),
             m_incomplete( false ),
-            m_json_parsed( false)
+            m_json_parsed( false),
+            m_pooled( false )
     {
     }
 
@@ -144,16 +156,24 @@ private:
         :   m_length( len ),
             m_flags( flags ),
             m_incomplete( true ),
-            m_json_parsed( false)
+            m_json_parsed( false),
+            m_pooled( false )
     {
     }
 
-    QByteArray m_payload;
+    /// replaces the payload, dropping a prebuilt frame
+    void setPayload( const QByteArray& ba );
+
+    static void recycleFrame( QByteArray& frame );
+
+    mutable QByteArray m_payload;
+    QByteArray m_frame;
     quint32 m_length;
     char m_flags;
     bool m_incomplete;
     QVariant m_json;
     bool m_json_parsed;
+    bool m_pooled;
 };
 
 #endif // MSG_H
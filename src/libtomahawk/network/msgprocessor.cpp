@@ -18,17 +18,189 @@
 
 #include "msgprocessor.h"
 
+#include <QtEndian>
+
 #include "network/servent.h"
 #include "utils/logger.h"
 
+#include "config.h"
+
+#ifdef ZLIB_FOUND
+    #include <string.h>
+    #include <zlib.h>
+#endif
+
+// shared by all connections, so a big dbsync can't eat every core
+#define MAX_WORKER_THREADS 2
+
+// biggest msg we inflate for a peer, whatever its size header claims
+#define MAX_UNCOMPRESSED_SIZE 32 * 1024 * 1024
+#define UNCOMPRESS_CHUNK_SIZE 64 * 1024
+
+#ifdef ZLIB_FOUND
+// Keys and values most of our JSON msgs are made of, most frequent last.
+// Both ends must use the very same bytes: changing this needs a new feature
+// name in ControlConnection::sendFeatures().
+static const char s_dictionary[] =
+    "\"conntype\":\"request-offer\",\"controlid\":\"offer\":\"key\":\"dbsync-offer\","
+    "\"method\":\"fetchops\",\"lastop\":\"features\",\"binaryops\":true,\"playlistdeltas\":true,"
+    "\"composer\":\"discnumber\":\"albumpos\":\"year\":\"bitrate\":\"mimetype\":\"audio/mpeg\","
+    "\"hash\":\"size\":\"mtime\":\"duration\":\"url\":\"file:///\",\"id\":"
+    "\"playlistguid\":\"oldrev\":\"newrev\":\"orderedguids\":[\"addedentries\":[\"entrydelta\":"
+    "\"currentrevision\":\"creator\":\"annotation\":\"info\":\"shared\":\"title\":"
+    "\"action\":\"comment\":\"timestamp\":\"secsPlayed\":\"playtime\":\"query\":\"qid\":"
+    "\"command\":\"addfiles\",\"deletefiles\",\"logplayback\",\"setplaylistrevision\",\"files\":[{"
+    "\"artist\":\"album\":\"track\":\"guid\":\"";
+#endif
+
+
+static QByteArray
+dictionaryCompress( const QByteArray& data, int level )
+{
+#ifdef ZLIB_FOUND
+    z_stream zs;
+    memset( &zs, 0, sizeof( zs ) );
+    if ( deflateInit( &zs, level ) != Z_OK )
+        return QByteArray();
+
+    deflateSetDictionary( &zs, (const Bytef*)s_dictionary, sizeof( s_dictionary ) - 1 );
+
+    // prefixed with the uncompressed size, like qCompress does
+    QByteArray out;
+    out.resize( 4 + deflateBound( &zs, data.size() ) + 16 );
+    qToBigEndian< quint32 >( data.size(), (uchar*)out.data() );
+
+    zs.next_in = (Bytef*)data.constData();
+    zs.avail_in = data.size();
+    zs.next_out = (Bytef*)out.data() + 4;
+    zs.avail_out = out.size() - 4;
+
+    const int ret = deflate( &zs, Z_FINISH );
+    out.resize( 4 + zs.total_out );
+    deflateEnd( &zs );
+
+    if ( ret == Z_STREAM_END )
+        return out;
+#else
+    Q_UNUSED( data );
+    Q_UNUSED( level );
+#endif
+
+    return QByteArray();
+}
+
+
+static QByteArray
+dictionaryUncompress( const QByteArray& data )
+{
+#ifdef ZLIB_FOUND
+    if ( data.size() < 4 )
+        return QByteArray();
+
+    // the size header comes from the peer, it's only checked at the end
+    const quint32 expected = qFromBigEndian< quint32 >( (const uchar*)data.constData() );
+    if ( expected > MAX_UNCOMPRESSED_SIZE )
+    {
+        tLog() << Q_FUNC_INFO << "Refusing to uncompress msg of" << expected << "bytes";
+        return QByteArray();
+    }
+
+    z_stream zs;
+    memset( &zs, 0, sizeof( zs ) );
+    if ( inflateInit( &zs ) != Z_OK )
+        return QByteArray();
+
+    zs.next_in = (Bytef*)data.constData() + 4;
+    zs.avail_in = data.size() - 4;
+
+    // grow the output a chunk at a time, like qUncompress does
+    QByteArray out;
+    int ret = Z_OK;
+    while ( ret == Z_OK )
+    {
+        const int written = zs.total_out;
+        if ( written >= MAX_UNCOMPRESSED_SIZE )
+        {
+            ret = Z_MEM_ERROR;
+            break;
+        }
+
+        out.resize( qMin( written + UNCOMPRESS_CHUNK_SIZE, MAX_UNCOMPRESSED_SIZE ) );
+        zs.next_out = (Bytef*)out.data() + written;
+        zs.avail_out = out.size() - written;
+
+        ret = inflate( &zs, Z_NO_FLUSH );
+        if ( ret == Z_NEED_DICT )
+        {
+            ret = inflateSetDictionary( &zs, (const Bytef*)s_dictionary, sizeof( s_dictionary ) - 1 );
+            continue;
+        }
+
+        // truncated input: no progress possible with more room
+        if ( ret == Z_BUF_ERROR && zs.avail_out > 0 )
+            break;
+        if ( ret == Z_BUF_ERROR )
+            ret = Z_OK;
+    }
+    out.resize( zs.total_out );
+    inflateEnd( &zs );
+
+    if ( ret == Z_STREAM_END && (quint32)out.size() == expected )
+        return out;
+
+    tLog() << Q_FUNC_INFO << "Invalid dictionary compressed msg, error:" << ret << "size:" << out.size() << "expected:" << expected;
+#else
+    Q_UNUSED( data );
+#endif
+
+    return QByteArray();
+}
+
+
+MsgProcessorJob::MsgProcessorJob( const QList<msg_ptr>& msgs, quint32 mode, quint32 threshold )
+    : QObject()
+    , QRunnable()
+    , m_msgs( msgs )
+    , m_mode( mode )
+    , m_threshold( threshold )
+{
+    // deleted in the thread that created us, once done() has been delivered
+    setAutoDelete( false );
+    connect( this, SIGNAL( done( QList<msg_ptr> ) ), SLOT( deleteLater() ), Qt::QueuedConnection );
+}
+
+
+void
+MsgProcessorJob::run()
+{
+    foreach ( const msg_ptr& msg, m_msgs )
+        MsgProcessor::process( msg, m_mode, m_threshold );
+
+    emit done( m_msgs );
+}
+
 
 MsgProcessor::MsgProcessor( quint32 mode, quint32 t ) :
-    QObject(), m_mode( mode ), m_threshold( t ), m_totmsgsize( 0 )
+    QObject(), m_mode( mode ), m_threshold( t ), m_batchRunning( false ), m_totmsgsize( 0 )
 {
     moveToThread( Servent::instance()->thread() );
 }
 
 
+QThreadPool*
+MsgProcessor::pool()
+{
+    static QThreadPool* s_pool = 0;
+    if ( !s_pool )
+    {
+        s_pool = new QThreadPool();
+        s_pool->setMaxThreadCount( qBound( 1, QThread::idealThreadCount(), MAX_WORKER_THREADS ) );
+    }
+
+    return s_pool;
+}
+
+
 void
 MsgProcessor::append( msg_ptr msg )
 {
@@ -42,32 +214,47 @@ MsgProcessor::append( msg_ptr msg )
     m_msgs.append( msg );
     m_msg_ready.insert( msg.data(), false );
 
-    m_totmsgsize += msg->payload().length();
+    m_totmsgsize += msg->length();
 
-    if( m_mode & NOTHING )
+    if( m_mode == NOTHING )
     {
         //qDebug() << "MsgProcessor::NOTHING";
         handleProcessedMsg( msg );
         return;
     }
 
-    QFuture<msg_ptr> fut = QtConcurrent::run(&MsgProcessor::process, msg, m_mode, m_threshold);
-    QFutureWatcher<msg_ptr> * watcher = new QFutureWatcher<msg_ptr>;
-    connect( watcher, SIGNAL( finished() ),
-             this, SLOT( processed() ),
+    m_pending.append( msg );
+    if ( !m_batchRunning )
+        startBatch();
+}
+
+
+void
+MsgProcessor::startBatch()
+{
+    // everything that queued up while the last batch was running goes in one job
+    MsgProcessorJob* job = new MsgProcessorJob( m_pending, m_mode, m_threshold );
+    m_pending.clear();
+    m_batchRunning = true;
+
+    connect( job, SIGNAL( done( QList<msg_ptr> ) ),
+             this, SLOT( processed( QList<msg_ptr> ) ),
              Qt::QueuedConnection );
 
-    watcher->setFuture( fut );
+    pool()->start( job );
 }
 
 
 void
-MsgProcessor::processed()
+MsgProcessor::processed( const QList<msg_ptr>& msgs )
 {
-    QFutureWatcher<msg_ptr> * watcher = (QFutureWatcher<msg_ptr> *) sender();
-    msg_ptr msg = watcher->result();
-    watcher->deleteLater();
-    handleProcessedMsg( msg );
+    m_batchRunning = false;
+
+    foreach ( const msg_ptr& msg, msgs )
+        handleProcessedMsg( msg );
+
+    if ( !m_pending.isEmpty() )
+        startBatch();
 }
 
 
@@ -98,7 +285,18 @@ MsgProcessor::handleProcessedMsg( msg_ptr msg )
 }
 
 
-/// This method is run by QtConcurrent:
+bool
+MsgProcessor::dictionarySupported()
+{
+#ifdef ZLIB_FOUND
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+/// This method is run by the worker pool:
 msg_ptr
 MsgProcessor::process( msg_ptr msg, quint32 mode, quint32 threshold )
 {
@@ -106,8 +304,14 @@ MsgProcessor::process( msg_ptr msg, quint32 mode, quint32 threshold )
     if( (mode & UNCOMPRESS_ALL) && msg->is( Msg::COMPRESSED ) )
     {
 //        qDebug() << "MsgProcessor::UNCOMPRESSING";
-        msg->m_payload = qUncompress( msg->payload() );
-        msg->m_length  = msg->m_payload.length();
+        if ( msg->is( Msg::DICTIONARY ) )
+        {
+            msg->setPayload( dictionaryUncompress( msg->payload() ) );
+            msg->m_flags ^= Msg::DICTIONARY;
+        }
+        else
+            msg->setPayload( qUncompress( msg->payload() ) );
+
         msg->m_flags ^= Msg::COMPRESSED;
     }
 
@@ -121,6 +325,10 @@ MsgProcessor::process( msg_ptr msg, quint32 mode, quint32 threshold )
         QJson::Parser parser;
         msg->m_json = parser.parse( msg->payload(), &ok );
         msg->m_json_parsed = true;
+
+        // nobody needs the raw json once it's parsed, don't keep both around
+        if ( ok )
+            msg->m_payload = QByteArray();
     }
 
     // compress if needed
@@ -129,8 +337,16 @@ MsgProcessor::process( msg_ptr msg, quint32 mode, quint32 threshold )
         && msg->length() > threshold )
     {
 //        qDebug() << "MsgProcessor::COMPRESSING";
-        msg->m_payload = qCompress( msg->payload(), 9 );
-        msg->m_length  = msg->m_payload.length();
+        QByteArray compressed;
+        if ( mode & COMPRESS_WITH_DICTIONARY )
+            compressed = dictionaryCompress( msg->payload(), MSG_COMPRESSION_LEVEL );
+
+        if ( !compressed.isEmpty() )
+            msg->m_flags |= Msg::DICTIONARY;
+        else
+            compressed = qCompress( msg->payload(), MSG_COMPRESSION_LEVEL );
+
+        msg->setPayload( compressed );
         msg->m_flags |= Msg::COMPRESSED;
     }
     return msg;
@@ -21,9 +21,12 @@
     it emits done(msg_ptr) for each msg, preserving the order.
 
     It can be configured to auto-compress, or de-compress msgs for sending
-    or receiving.
+    or receiving. With COMPRESS_WITH_DICTIONARY, msgs are deflated against a
+    preset dictionary of our common JSON keys, which only peers advertising
+    the "zlibdict1" feature on their ControlConnection can read.
 
-    It uses QtConcurrent, but preserves msg order.
+    Msgs are handed to a small shared thread pool in batches, one batch in
+    flight per MsgProcessor, which preserves msg order.
 
     NOT threadsafe.
 */
@@ -31,9 +34,8 @@
 #define MSGPROCESSOR_H
 
 #include <QObject>
-#include <QtConcurrentRun>
-#include <QFuture>
-#include <QFutureWatcher>
+#include <QRunnable>
+#include <QThreadPool>
 
 #include <qjson/parser.h>
 #include <qjson/serializer.h>
@@ -41,6 +43,28 @@
 
 #include "msg.h"
 
+// zlib level used for outgoing msgs: 1 is several times faster than 9 and
+// only a little bigger for our JSON payloads. Any level decompresses the same.
+#define MSG_COMPRESSION_LEVEL 1
+
+class MsgProcessorJob : public QObject, public QRunnable
+{
+Q_OBJECT
+public:
+    MsgProcessorJob( const QList<msg_ptr>& msgs, quint32 mode, quint32 threshold );
+
+    virtual void run();
+
+signals:
+    void done( const QList<msg_ptr>& msgs );
+
+private:
+    QList<msg_ptr> m_msgs;
+    quint32 m_mode;
+    quint32 m_threshold;
+};
+
+
 class MsgProcessor : public QObject
 {
 Q_OBJECT
@@ -50,7 +74,8 @@ public:
         NOTHING = 0,
         COMPRESS_IF_LARGE = 1,
         UNCOMPRESS_ALL = 2,
-        PARSE_JSON = 4
+        PARSE_JSON = 4,
+        COMPRESS_WITH_DICTIONARY = 8
     };
 
     explicit MsgProcessor( quint32 mode = NOTHING, quint32 t = 512 );
@@ -59,6 +84,9 @@ public:
 
     static msg_ptr process( msg_ptr msg, quint32 mode, quint32 threshold );
 
+    /// whether we were built with zlib, and can use COMPRESS_WITH_DICTIONARY
+    static bool dictionarySupported();
+
     int length() const { return m_msgs.length(); }
 
 signals:
@@ -67,15 +95,20 @@ signals:
 
 public slots:
     void append( msg_ptr msg );
-    void processed();
+    void processed( const QList<msg_ptr>& msgs );
 
 private:
     void handleProcessedMsg( msg_ptr msg );
+    void startBatch();
+
+    static QThreadPool* pool();
 
     quint32 m_mode;
     quint32 m_threshold;
     QList<msg_ptr> m_msgs;
     QMap< Msg*, bool> m_msg_ready;
+    QList<msg_ptr> m_pending;
+    bool m_batchRunning;
     unsigned int m_totmsgsize;
 };
 
@@ -0,0 +1,75 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Copyright 2010-2011, Christian Muehlhaeuser <muesli@tomahawk-player.org>
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "rangeiodevice.h"
+
+#include "utils/logger.h"
+
+
+RangeIODevice::RangeIODevice( const QSharedPointer<QIODevice>& source, qint64 offset, qint64 length, QObject* parent )
+    : QIODevice( parent )
+    , m_source( source )
+    , m_offset( offset )
+    , m_length( length )
+    , m_left( length )
+{
+}
+
+
+bool
+RangeIODevice::open( OpenMode mode )
+{
+    if ( !m_source->seek( m_offset ) )
+    {
+        tLog() << "Could not seek to" << m_offset << "in range device source";
+        return false;
+    }
+
+    m_left = m_length;
+    return QIODevice::open( mode | QIODevice::Unbuffered );
+}
+
+
+qint64
+RangeIODevice::bytesAvailable() const
+{
+    return qMin( m_left, m_source->bytesAvailable() ) + QIODevice::bytesAvailable();
+}
+
+
+qint64
+RangeIODevice::readData( char* data, qint64 maxSize )
+{
+    if ( m_left <= 0 )
+        return -1;
+
+    const qint64 read = m_source->read( data, qMin( maxSize, m_left ) );
+    if ( read > 0 )
+        m_left -= read;
+
+    return read;
+}
+
+
+qint64
+RangeIODevice::writeData( const char* data, qint64 maxSize )
+{
+    Q_UNUSED( data );
+    Q_UNUSED( maxSize );
+    return -1;
+}
@@ -0,0 +1,55 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Copyright 2010-2011, Christian Muehlhaeuser <muesli@tomahawk-player.org>
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RANGEIODEVICE_H
+#define RANGEIODEVICE_H
+
+#include <QtCore/QIODevice>
+#include <QtCore/QSharedPointer>
+
+#include "dllmacro.h"
+
+/**
+ * Exposes length bytes of a random-access device, starting at offset,
+ * e.g. to answer HTTP range requests.
+ */
+class DLLEXPORT RangeIODevice : public QIODevice
+{
+Q_OBJECT
+
+public:
+    explicit RangeIODevice( const QSharedPointer<QIODevice>& source, qint64 offset, qint64 length, QObject* parent = 0 );
+
+    virtual bool open( OpenMode mode );
+    virtual bool isSequential() const { return true; }
+    virtual bool atEnd() const { return m_left <= 0; }
+    virtual qint64 bytesAvailable() const;
+    virtual qint64 size() const { return m_length; }
+
+protected:
+    virtual qint64 readData( char* data, qint64 maxSize );
+    virtual qint64 writeData( const char* data, qint64 maxSize );
+
+private:
+    QSharedPointer<QIODevice> m_source;
+    qint64 m_offset;
+    qint64 m_length;
+    qint64 m_left;
+};
+
+#endif // RANGEIODEVICE_H
@@ -30,6 +30,9 @@
 #include "result.h"
 #include "source.h"
 #include "bufferiodevice.h"
+#include "httpstream.h"
+#include "streamcache.h"
+#include "uploadscheduler.h"
 #include "connection.h"
 #include "controlconnection.h"
 #include "database/database.h"
@@ -42,6 +45,9 @@
 #include "utils/tomahawkutils.h"
 #include "utils/logger.h"
 
+// network threads that stream connections get spread over
+#define MAX_IO_THREADS 4
+
 using namespace Tomahawk;
 
 Servent* Servent::s_instance = 0;
@@ -65,6 +71,8 @@ Servent::Servent( QObject* parent )
 
     m_lanHack = qApp->arguments().contains( "--lanhack" );
     new ACLSystem( this );
+    new StreamCache( this );
+    new UploadScheduler( this );
     setProxy( QNetworkProxy::NoProxy );
 
     {
@@ -90,6 +98,13 @@ Servent::Servent( QObject* parent )
 Servent::~Servent()
 {
     delete m_portfwd;
+
+    foreach ( QThread* thread, m_ioThreads )
+    {
+        thread->quit();
+        thread->wait();
+        delete thread;
+    }
 }
 
 
@@ -264,6 +279,12 @@ Servent::unregisterControlConnection( ControlConnection* conn )
 
     m_connectedNodes.removeAll( conn->id() );
     m_controlconnections = n;
+
+    // idle streams to that peer are of no use anymore
+    QMutexLocker lock( &m_ftsession_mut );
+    foreach ( StreamConnection* sc, m_parkedStreams.values( conn ) )
+        QMetaObject::invokeMethod( sc, "shutdown", Qt::QueuedConnection );
+    m_parkedStreams.remove( conn );
 }
 
 
@@ -415,6 +436,17 @@ closeconnection:
 void
 Servent::createParallelConnection( Connection* orig_conn, Connection* new_conn, const QString& key )
 {
+    // streams and the audio engine ask from their own threads, but offers and sockets live in ours
+    if ( QThread::currentThread() != thread() )
+    {
+        QMetaObject::invokeMethod( this, "createParallelConnection",
+                                   Qt::QueuedConnection,
+                                   Q_ARG( Connection*, orig_conn ),
+                                   Q_ARG( Connection*, new_conn ),
+                                   Q_ARG( QString, key ) );
+        return;
+    }
+
     tDebug( LOGVERBOSE ) << Q_FUNC_INFO << ", key:" << key << thread() << orig_conn;
     // if we can connect to them directly:
     if( orig_conn && orig_conn->outbound() )
@@ -462,6 +494,8 @@ void Servent::handoverSocket( Connection* conn, QTcpSocketExtra* sock )
     Q_ASSERT( sock );
     Q_ASSERT( conn->socket().isNull() );
     Q_ASSERT( sock->isValid() );
+    // only the owning thread may push the socket on to a network thread
+    Q_ASSERT( sock->thread() == QThread::currentThread() );
 
     disconnect( sock, SIGNAL( readyRead() ),    this, SLOT( readyRead() ) );
     disconnect( sock, SIGNAL( disconnected() ), sock, SLOT( deleteLater() ) );
@@ -472,10 +506,69 @@ void Servent::handoverSocket( Connection* conn, QTcpSocketExtra* sock )
     conn->setOutbound( sock->_outbound );
     conn->setPeerPort( sock->peerPort() );
 
+    // streams only talk to their socket and buffer, so they can move off our event loop.
+    // control and dbsync connections work on Sources and the Database directly and stay here
+    if ( qobject_cast< StreamConnection* >( conn ) )
+    {
+        QThread* thread = ioThread();
+        {
+            QMutexLocker lock( &m_ioThreadMutex );
+            m_ioThreadLoad[ thread ]++;
+            m_shardedConnections.insert( conn, thread );
+        }
+        connect( conn, SIGNAL( destroyed( QObject* ) ),
+                       SLOT( onShardedConnectionDestroyed( QObject* ) ), Qt::DirectConnection );
+
+        conn->moveToThread( thread );
+        sock->moveToThread( thread );
+    }
+
     conn->start( sock );
 }
 
 
+QThread*
+Servent::ioThread()
+{
+    if ( m_ioThreads.isEmpty() )
+    {
+        const int count = qBound( 1, QThread::idealThreadCount() - 1, MAX_IO_THREADS );
+        for ( int i = 0; i < count; i++ )
+        {
+            QThread* thread = new QThread();
+            thread->setObjectName( QString( "ServentIO%1" ).arg( i ) );
+            thread->start();
+
+            m_ioThreads << thread;
+            m_ioThreadLoad.insert( thread, 0 );
+        }
+
+        tLog() << "Servent spreading streams over" << count << "network threads";
+    }
+
+    QMutexLocker lock( &m_ioThreadMutex );
+    QThread* least = m_ioThreads.first();
+    foreach ( QThread* thread, m_ioThreads )
+    {
+        if ( m_ioThreadLoad.value( thread ) < m_ioThreadLoad.value( least ) )
+            least = thread;
+    }
+
+    return least;
+}
+
+
+void
+Servent::onShardedConnectionDestroyed( QObject* conn )
+{
+    // called from the connection's thread, conn is only used as a key
+    QMutexLocker lock( &m_ioThreadMutex );
+    QThread* thread = m_shardedConnections.take( conn );
+    if ( thread )
+        m_ioThreadLoad[ thread ]--;
+}
+
+
 void
 Servent::socketError( QAbstractSocket::SocketError e )
 {
@@ -535,6 +628,7 @@ Servent::connectToPeer( const QString& ha, int port, const QString &key, Connect
     tDebug( LOGVERBOSE ) << "Servent::connectToPeer:" << ha << ":" << port
                          << thread() << QThread::currentThread();
 
+    Q_ASSERT( this->thread() == QThread::currentThread() );
     Q_ASSERT( port > 0 );
     Q_ASSERT( conn );
 
@@ -765,6 +859,12 @@ Servent::remoteIODeviceFactory( const result_ptr& result )
         return sp;
 
     ControlConnection* cc = s->controlConnection();
+
+    // an idle connection to that peer saves us the offer and handshake round trips
+    sp = reuseParkedStream( cc, fileId, result );
+    if ( !sp.isNull() )
+        return sp;
+
     StreamConnection* sc = new StreamConnection( this, cc, fileId, result );
     createParallelConnection( cc, sc, QString( "FILE_REQUEST_KEY:%1" ).arg( fileId ) );
     return sc->iodevice();
@@ -774,14 +874,22 @@ Servent::remoteIODeviceFactory( const result_ptr& result )
 void
 Servent::registerStreamConnection( StreamConnection* sc )
 {
+    // called in the stream's own thread
+    QMutexLocker lock( &m_ftsession_mut );
     Q_ASSERT( !m_scsessions.contains( sc ) );
     tDebug( LOGVERBOSE ) << "Registering Stream" << m_scsessions.length() + 1;
 
-    QMutexLocker lock( &m_ftsession_mut );
     m_scsessions.append( sc );
-
     printCurrentTransfers();
-    emit streamStarted( sc );
+
+    connect( sc, SIGNAL( transferRateChanged( StreamConnection*, qint64 ) ),
+                 SIGNAL( streamUpdated( StreamConnection*, qint64 ) ), Qt::UniqueConnection );
+
+    QMetaObject::invokeMethod( this, "streamStarted", Qt::QueuedConnection,
+                               Q_ARG( StreamConnection*, sc ),
+                               Q_ARG( Tomahawk::result_ptr, sc->track() ),
+                               Q_ARG( Tomahawk::source_ptr, sc->source() ),
+                               Q_ARG( bool, sc->type() == StreamConnection::RECEIVING ) );
 }
 
 
@@ -792,10 +900,57 @@ Servent::onStreamFinished( StreamConnection* sc )
     tDebug( LOGVERBOSE ) << "Stream Finished, unregistering" << sc->id();
 
     QMutexLocker lock( &m_ftsession_mut );
-    m_scsessions.removeAll( sc );
+    if ( !m_scsessions.removeAll( sc ) )
+        return;
 
     printCurrentTransfers();
-    emit streamFinished( sc );
+
+    // queued even from our own thread, so it can't overtake streamStarted()
+    QMetaObject::invokeMethod( this, "streamFinished", Qt::QueuedConnection, Q_ARG( StreamConnection*, sc ) );
+}
+
+
+void
+Servent::parkStream( StreamConnection* sc )
+{
+    onStreamFinished( sc );
+
+    QMutexLocker lock( &m_ftsession_mut );
+    if ( !m_parkedStreams.contains( sc->controlConnection(), sc ) )
+        m_parkedStreams.insert( sc->controlConnection(), sc );
+}
+
+
+bool
+Servent::unparkStream( StreamConnection* sc )
+{
+    QMutexLocker lock( &m_ftsession_mut );
+    return m_parkedStreams.remove( sc->controlConnection(), sc ) > 0;
+}
+
+
+QSharedPointer<QIODevice>
+Servent::reuseParkedStream( ControlConnection* cc, const QString& fid, const result_ptr& result )
+{
+    // parked streams live in their own network thread and may be going away right now.
+    // Their destructor unparks them first, so holding the lock over reuse() keeps
+    // them alive until the handover is done
+    QMutexLocker lock( &m_ftsession_mut );
+    QMultiHash< ControlConnection*, StreamConnection* >::iterator it = m_parkedStreams.find( cc );
+    if ( it == m_parkedStreams.end() )
+        return QSharedPointer<QIODevice>();
+
+    StreamConnection* sc = it.value();
+    m_parkedStreams.erase( it );
+    return sc->reuse( fid, result );
+}
+
+
+QList< StreamConnection* >
+Servent::streams() const
+{
+    QMutexLocker lock( &m_ftsession_mut );
+    return m_scsessions;
 }
 
 
@@ -887,6 +1042,14 @@ Servent::getIODeviceForUrl( const Tomahawk::result_ptr& result )
     if ( !m_iofactories.contains( proto ) )
         return sp;
 
+    // tracks we streamed completely before are served from our local stream cache
+    if ( proto == "servent" || proto == "http" )
+    {
+        sp = StreamCache::instance()->cachedIODevice( StreamCache::key( result ) );
+        if ( !sp.isNull() )
+            return sp;
+    }
+
     return m_iofactories.value( proto )( result );
 }
 
@@ -896,8 +1059,9 @@ Servent::localFileIODeviceFactory( const Tomahawk::result_ptr& result )
 {
     // ignore "file://" at front of url
     QFile* io = new QFile( result->url().mid( QString( "file://" ).length() ) );
+    // unbuffered: the web api and phonon read in large blocks already
     if ( io )
-        io->open( QIODevice::ReadOnly );
+        io->open( QIODevice::ReadOnly | QIODevice::Unbuffered );
 
     return QSharedPointer<QIODevice>( io );
 }
@@ -906,7 +1070,21 @@ Servent::localFileIODeviceFactory( const Tomahawk::result_ptr& result )
 QSharedPointer<QIODevice>
 Servent::httpIODeviceFactory( const Tomahawk::result_ptr& result )
 {
-    QNetworkRequest req( result->url() );
-    QNetworkReply* reply = TomahawkUtils::nam()->get( req );
-    return QSharedPointer<QIODevice>( reply, &QObject::deleteLater );
+    const QUrl url = TomahawkUtils::resolverUrl( result->url() );
+
+    // without a size we can't lay out blocks, so just stream it as is
+    if ( result->size() <= 0 )
+    {
+        QNetworkReply* reply = TomahawkUtils::nam()->get( QNetworkRequest( url ) );
+        return QSharedPointer<QIODevice>( reply, &QObject::deleteLater );
+    }
+
+    // the stream downloads into the buffer, and the stream cache on the way,
+    // and dies with it
+    BufferIODevice* bio = new BufferIODevice( result->size() );
+    QSharedPointer<QIODevice> sp( bio, &QObject::deleteLater );
+    bio->open( QIODevice::ReadWrite );
+    new HttpStream( bio, result, url );
+
+    return sp;
 }
@@ -24,6 +24,7 @@
 
 #include <QtCore/QObject>
 #include <QtCore/QMap>
+#include <QtCore/QHash>
 #include <QtCore/QMutex>
 #include <QtCore/QSharedPointer>
 #include <QtCore/QTimer>
@@ -50,6 +51,7 @@ class StreamConnection;
 class ProxyConnection;
 class RemoteCollectionConnection;
 class PortFwdThread;
+class QThread;
 
 // this is used to hold a bit of state, so when a connected signal is emitted
 // from a socket, we can associate it with a Connection object etc.
@@ -116,7 +118,13 @@ public:
     bool connectedToSession( const QString& session );
     unsigned int numConnectedPeers() const { return m_controlconnections.length(); }
 
-    QList< StreamConnection* > streams() const { return m_scsessions; }
+    QList< StreamConnection* > streams() const;
+
+    // finished RX streams whose peer keeps the connection open for the next file
+    void parkStream( StreamConnection* sc );
+    bool unparkStream( StreamConnection* sc );
+    // hands the next file to an idle stream to that peer, a null device if there is none
+    QSharedPointer<QIODevice> reuseParkedStream( ControlConnection* cc, const QString& fid, const Tomahawk::result_ptr& result );
 
     QSharedPointer<QIODevice> getIODeviceForUrl( const Tomahawk::result_ptr& result );
     void registerIODeviceFactory( const QString &proto, boost::function<QSharedPointer<QIODevice>(Tomahawk::result_ptr)> fac );
@@ -126,8 +134,11 @@ public:
     bool isReady() const { return m_ready; };
 
 signals:
-    void streamStarted( StreamConnection* );
-    void streamFinished( StreamConnection* );
+    // always emitted from our thread. Streams live in network threads, so receivers
+    // get what they need by value and must not dereference the StreamConnection
+    void streamStarted( StreamConnection* sc, const Tomahawk::result_ptr& track, const Tomahawk::source_ptr& source, bool receiving );
+    void streamUpdated( StreamConnection* sc, qint64 transferRate );
+    void streamFinished( StreamConnection* sc );
     void ready();
 
 protected:
@@ -148,12 +159,14 @@ public slots:
 
 private slots:
     void readyRead();
+    void onShardedConnectionDestroyed( QObject* conn );
 
     Connection* claimOffer( ControlConnection* cc, const QString &nodeid, const QString &key, const QHostAddress peer = QHostAddress::Any );
 
 private:
     bool isValidExternalIP( const QHostAddress& addr ) const;
     void handoverSocket( Connection* conn, QTcpSocketExtra* sock );
+    QThread* ioThread();
     bool checkACL( const Connection* conn, const QString &nodeid, bool showDialog ) const;
     void printCurrentTransfers();
 
@@ -170,7 +183,14 @@ private:
 
     // currently active file transfers:
     QList< StreamConnection* > m_scsessions;
-    QMutex m_ftsession_mut;
+    QMultiHash< ControlConnection*, StreamConnection* > m_parkedStreams;
+    mutable QMutex m_ftsession_mut;
+
+    // stream connections are spread over these, everything else stays in our thread
+    QList< QThread* > m_ioThreads;
+    QHash< QThread*, int > m_ioThreadLoad;
+    QHash< QObject*, QThread* > m_shardedConnections;
+    QMutex m_ioThreadMutex;
 
     QMap< QString,boost::function<QSharedPointer<QIODevice>(Tomahawk::result_ptr)> > m_iofactories;
 
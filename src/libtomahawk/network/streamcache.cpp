@@ -0,0 +1,417 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Copyright 2010-2011, Christian Muehlhaeuser <muesli@tomahawk-player.org>
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "streamcache.h"
+
+#include <QtCore/QCryptographicHash>
+#include <QtCore/QDataStream>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QMutexLocker>
+
+#include "result.h"
+#include "tomahawksettings.h"
+#include "bufferiodevice.h"
+#include "utils/logger.h"
+
+// bump this when the on-disk layout changes, old caches get wiped
+#define STREAMCACHE_VERSION 1
+
+using namespace Tomahawk;
+
+StreamCache* StreamCache::s_instance = 0;
+
+
+StreamCache*
+StreamCache::instance()
+{
+    return s_instance;
+}
+
+
+StreamCache::StreamCache( QObject* parent )
+    : QObject( parent )
+    , m_cacheDir( TomahawkSettings::instance()->storageCacheLocation() + "/StreamCache/" )
+    , m_storedBytes( 0 )
+    , m_maxBytes( (qint64)TomahawkSettings::instance()->streamCacheSize() * 1024 * 1024 )
+    , m_mutex( QMutex::Recursive )
+{
+    s_instance = this;
+
+    QDir().mkpath( m_cacheDir );
+    loadIndex();
+
+    m_flushTimer.setInterval( 10000 );
+    m_flushTimer.setSingleShot( true );
+    connect( &m_flushTimer, SIGNAL( timeout() ), SLOT( flush() ) );
+
+    tDebug() << Q_FUNC_INFO << "Stream cache holds" << m_entries.count() << "tracks," << m_storedBytes << "bytes";
+}
+
+
+StreamCache::~StreamCache()
+{
+    flush();
+    s_instance = 0;
+}
+
+
+QString
+StreamCache::key( const Tomahawk::result_ptr& result )
+{
+    // servent urls identify source and file id, anything else is identified by its url.
+    // size and mtime make sure we don't serve stale data for files that changed since
+    const QString id = QString( "%1\t%2\t%3" ).arg( result->url() )
+                                              .arg( result->size() )
+                                              .arg( result->modificationTime() );
+
+    return QCryptographicHash::hash( id.toUtf8(), QCryptographicHash::Md5 ).toHex();
+}
+
+
+bool
+StreamCache::isComplete( const QString& key ) const
+{
+    QMutexLocker lock( &m_mutex );
+    if ( !m_entries.contains( key ) )
+        return false;
+
+    return isComplete( m_entries.value( key ) );
+}
+
+
+bool
+StreamCache::isComplete( const Entry& entry ) const
+{
+    return entry.size > 0 && entry.stored >= entry.size && entry.blocks.count( true ) == entry.blocks.size();
+}
+
+
+QSharedPointer<QIODevice>
+StreamCache::cachedIODevice( const QString& key )
+{
+    QMutexLocker lock( &m_mutex );
+    QSharedPointer<QIODevice> sp;
+    if ( !isComplete( key ) )
+        return sp;
+
+    closeWriter( key );
+
+    QFile* io = new QFile( dataPath( key ) );
+    if ( !io->open( QIODevice::ReadOnly ) || io->size() != m_entries.value( key ).size )
+    {
+        tLog() << "Stream cache entry is broken, dropping it:" << key;
+        delete io;
+        remove( key );
+        return sp;
+    }
+
+    m_entries[ key ].lastAccess = QDateTime::currentDateTime();
+    scheduleFlush();
+
+    tDebug( LOGVERBOSE ) << "Serving track from stream cache:" << key;
+    return QSharedPointer<QIODevice>( io );
+}
+
+
+int
+StreamCache::fill( const QString& key, BufferIODevice* buffer )
+{
+    QMutexLocker lock( &m_mutex );
+    if ( !m_entries.contains( key ) || m_entries.value( key ).size != buffer->size() )
+        return 0;
+
+    closeWriter( key );
+
+    QFile f( dataPath( key ) );
+    if ( !f.open( QIODevice::ReadOnly ) )
+        return 0;
+
+    const QBitArray blocks = m_entries.value( key ).blocks;
+    int filled = 0;
+    for ( int i = 0; i < blocks.size(); i++ )
+    {
+        if ( !blocks.testBit( i ) )
+            continue;
+
+        if ( !f.seek( (qint64)i * BufferIODevice::blockSize() ) )
+            break;
+
+        const QByteArray ba = f.read( BufferIODevice::blockSize() );
+        if ( ba.isEmpty() )
+            break;
+
+        buffer->addData( i, ba );
+        filled++;
+    }
+
+    m_entries[ key ].lastAccess = QDateTime::currentDateTime();
+    scheduleFlush();
+
+    tDebug( LOGVERBOSE ) << "Filled stream from cache:" << key << filled << "of" << buffer->maxBlocks() << "blocks";
+    return filled;
+}
+
+
+void
+StreamCache::addBlock( const QString& key, qint64 size, int block, const QByteArray& data )
+{
+    QMutexLocker lock( &m_mutex );
+    if ( m_maxBytes <= 0 || data.isEmpty() || block < 0 )
+        return;
+
+    // don't even start on tracks that would evict everything else
+    if ( size > m_maxBytes / 4 )
+        return;
+
+    if ( !m_entries.contains( key ) )
+    {
+        Entry e;
+        e.size = size;
+        e.stored = 0;
+        e.blocks = QBitArray( size > 0 ? ( size + BufferIODevice::blockSize() - 1 ) / BufferIODevice::blockSize() : 0 );
+        m_entries.insert( key, e );
+    }
+
+    Entry& e = m_entries[ key ];
+    if ( block >= e.blocks.size() )
+    {
+        if ( e.size > 0 )
+            return;
+
+        e.blocks.resize( block + 1 );
+    }
+
+    e.lastAccess = QDateTime::currentDateTime();
+    if ( e.blocks.testBit( block ) )
+        return;
+
+    QFile* f = writer( key );
+    if ( !f || !f->seek( (qint64)block * BufferIODevice::blockSize() ) || f->write( data ) != data.length() )
+    {
+        tLog() << "Failed writing to stream cache:" << dataPath( key );
+        remove( key );
+        return;
+    }
+
+    e.blocks.setBit( block );
+    e.stored += data.length();
+    m_storedBytes += data.length();
+
+    if ( isComplete( e ) )
+        closeWriter( key );
+
+    if ( m_storedBytes > m_maxBytes )
+        prune();
+
+    scheduleFlush();
+}
+
+
+void
+StreamCache::complete( const QString& key, qint64 size )
+{
+    QMutexLocker lock( &m_mutex );
+    if ( !m_entries.contains( key ) )
+        return;
+
+    Entry& e = m_entries[ key ];
+    e.size = size;
+    e.blocks.resize( ( size + BufferIODevice::blockSize() - 1 ) / BufferIODevice::blockSize() );
+
+    closeWriter( key );
+    if ( !isComplete( e ) )
+    {
+        tDebug() << "Stream ended, but cache entry has gaps:" << key;
+        return;
+    }
+
+    tDebug( LOGVERBOSE ) << "Completely cached stream:" << key << size;
+    scheduleFlush();
+}
+
+
+void
+StreamCache::clear()
+{
+    QMutexLocker lock( &m_mutex );
+    foreach ( const QString& key, m_entries.keys() )
+        remove( key );
+
+    saveIndex();
+}
+
+
+void
+StreamCache::flush()
+{
+    QMutexLocker lock( &m_mutex );
+    foreach ( const QString& key, m_writers.keys() )
+        closeWriter( key );
+
+    saveIndex();
+}
+
+
+void
+StreamCache::scheduleFlush()
+{
+    // the timer lives in our thread, addBlock() doesn't
+    QMetaObject::invokeMethod( &m_flushTimer, "start", Qt::QueuedConnection );
+}
+
+
+QString
+StreamCache::dataPath( const QString& key ) const
+{
+    return m_cacheDir + key;
+}
+
+
+QFile*
+StreamCache::writer( const QString& key )
+{
+    if ( m_writers.contains( key ) )
+        return m_writers.value( key );
+
+    QFile* f = new QFile( dataPath( key ) );
+    if ( !f->open( QIODevice::ReadWrite ) )
+    {
+        delete f;
+        return 0;
+    }
+
+    m_writers.insert( key, f );
+    return f;
+}
+
+
+void
+StreamCache::closeWriter( const QString& key )
+{
+    if ( !m_writers.contains( key ) )
+        return;
+
+    QFile* f = m_writers.take( key );
+    f->close();
+    delete f;
+}
+
+
+void
+StreamCache::remove( const QString& key )
+{
+    closeWriter( key );
+
+    if ( m_entries.contains( key ) )
+        m_storedBytes -= m_entries.take( key ).stored;
+
+    QFile::remove( dataPath( key ) );
+}
+
+
+void
+StreamCache::prune()
+{
+    // evict the least recently played tracks until we're back to 90% of our budget
+    const qint64 target = m_maxBytes * 9 / 10;
+
+    while ( m_storedBytes > target && !m_entries.isEmpty() )
+    {
+        QString oldest;
+        QDateTime oldestAccess;
+
+        QHash< QString, Entry >::const_iterator it = m_entries.constBegin();
+        for ( ; it != m_entries.constEnd(); ++it )
+        {
+            if ( oldest.isEmpty() || it.value().lastAccess < oldestAccess )
+            {
+                oldest = it.key();
+                oldestAccess = it.value().lastAccess;
+            }
+        }
+
+        tDebug( LOGVERBOSE ) << "Evicting from stream cache:" << oldest << m_entries.value( oldest ).stored;
+        remove( oldest );
+    }
+}
+
+
+void
+StreamCache::loadIndex()
+{
+    QFile f( m_cacheDir + "index" );
+    if ( !f.open( QIODevice::ReadOnly ) )
+        return;
+
+    QDataStream stream( &f );
+    quint32 version;
+    stream >> version;
+
+    if ( version == STREAMCACHE_VERSION )
+    {
+        quint32 count;
+        stream >> count;
+
+        for ( quint32 i = 0; i < count && stream.status() == QDataStream::Ok; i++ )
+        {
+            QString key;
+            Entry e;
+            stream >> key >> e.size >> e.stored >> e.blocks >> e.lastAccess;
+
+            if ( stream.status() != QDataStream::Ok || !QFile::exists( dataPath( key ) ) )
+                continue;
+
+            m_entries.insert( key, e );
+            m_storedBytes += e.stored;
+        }
+    }
+
+    // drop whatever we don't know about, e.g. data left over from a crash
+    QDir dir( m_cacheDir );
+    foreach ( const QString& file, dir.entryList( QDir::Files | QDir::NoDotAndDotDot ) )
+    {
+        if ( file != "index" && !m_entries.contains( file ) )
+            dir.remove( file );
+    }
+
+    if ( m_storedBytes > m_maxBytes )
+        prune();
+}
+
+
+void
+StreamCache::saveIndex()
+{
+    QFile f( m_cacheDir + "index" );
+    if ( !f.open( QIODevice::WriteOnly | QIODevice::Truncate ) )
+    {
+        tLog() << "Failed to write stream cache index:" << f.fileName();
+        return;
+    }
+
+    QDataStream stream( &f );
+    stream << (quint32)STREAMCACHE_VERSION << (quint32)m_entries.count();
+
+    QHash< QString, Entry >::const_iterator it = m_entries.constBegin();
+    for ( ; it != m_entries.constEnd(); ++it )
+    {
+        const Entry& e = it.value();
+        stream << it.key() << e.size << e.stored << e.blocks << e.lastAccess;
+    }
+}
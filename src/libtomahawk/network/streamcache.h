@@ -0,0 +1,107 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Copyright 2010-2011, Christian Muehlhaeuser <muesli@tomahawk-player.org>
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef STREAMCACHE_H
+#define STREAMCACHE_H
+
+#include <QtCore/QObject>
+#include <QtCore/QBitArray>
+#include <QtCore/QDateTime>
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QSharedPointer>
+#include <QtCore/QTimer>
+
+#include "typedefs.h"
+
+#include "dllmacro.h"
+
+class QFile;
+class QIODevice;
+class BufferIODevice;
+
+/**
+ * Size-bounded, least-recently-used on-disk cache of audio data we streamed from
+ * peers or HTTP servers. Data is stored in blocks of BufferIODevice::blockSize(),
+ * so partially streamed tracks can be resumed from where we left off.
+ *
+ * Threadsafe, blocks are added from Servent's network threads.
+ */
+class DLLEXPORT StreamCache : public QObject
+{
+Q_OBJECT
+
+public:
+    static StreamCache* instance();
+
+    explicit StreamCache( QObject* parent = 0 );
+    virtual ~StreamCache();
+
+    static QString key( const Tomahawk::result_ptr& result );
+
+    bool isComplete( const QString& key ) const;
+
+    // returns a local file for a completely cached track, or a null pointer
+    QSharedPointer<QIODevice> cachedIODevice( const QString& key );
+
+    // copies all cached blocks into buffer, returns the amount of blocks copied
+    int fill( const QString& key, BufferIODevice* buffer );
+
+    // size may be 0 if it isn't known yet, call complete() once it is
+    void addBlock( const QString& key, qint64 size, int block, const QByteArray& data );
+    void complete( const QString& key, qint64 size );
+
+public slots:
+    void clear();
+
+private slots:
+    void flush();
+
+private:
+    struct Entry
+    {
+        qint64 size;
+        qint64 stored;
+        QBitArray blocks;
+        QDateTime lastAccess;
+    };
+
+    QString dataPath( const QString& key ) const;
+    QFile* writer( const QString& key );
+    void closeWriter( const QString& key );
+    void remove( const QString& key );
+    void prune();
+    bool isComplete( const Entry& entry ) const;
+    void scheduleFlush();
+
+    void loadIndex();
+    void saveIndex();
+
+    QString m_cacheDir;
+    QHash< QString, Entry > m_entries;
+    QHash< QString, QFile* > m_writers;
+    qint64 m_storedBytes;
+    qint64 m_maxBytes;
+
+    QTimer m_flushTimer;
+    mutable QMutex m_mutex;
+
+    static StreamCache* s_instance;
+};
+
+#endif // STREAMCACHE_H
@@ -23,13 +23,26 @@
 #include "result.h"
 
 #include "bufferiodevice.h"
+#include "streamcache.h"
+#include "uploadscheduler.h"
 #include "network/controlconnection.h"
 #include "network/servent.h"
 #include "database/databasecommand_loadfiles.h"
+#include "database/databasecommand_identicalfiles.h"
 #include "database/database.h"
 #include "sourcelist.h"
 #include "utils/logger.h"
 
+// only worth the overhead for big files, e.g. lossless ones
+#define SWARM_MIN_SIZE 8 * 1024 * 1024
+#define SWARM_MAX_HELPERS 3
+
+// blocks we let pile up in the socket before waiting for the peer to catch up
+#define MAX_BUFFERED_BLOCKS 8
+
+// how long a finished connection waits for the next file before it's closed
+#define STREAM_IDLE_TIMEOUT 60 * 1000
+
 using namespace Tomahawk;
 
 
@@ -44,6 +57,15 @@ StreamConnection::StreamConnection( Servent* s, ControlConnection* cc, QString f
     , m_allok( false )
     , m_result( result )
     , m_transferRate( 0 )
+    , m_requestedBlock( -1 )
+    , m_peerReady( false )
+    , m_deferredBlock( -1 )
+    , m_swarmHelper( false )
+    , m_sendScheduled( false )
+    , m_keepAlive( false )
+    , m_awaitingFetch( false )
+    , m_pendingSeek( -1 )
+    , m_idleTimer( 0 )
 {
     qDebug() << Q_FUNC_INFO;
 
@@ -51,6 +73,10 @@ StreamConnection::StreamConnection( Servent* s, ControlConnection* cc, QString f
     m_iodev = QSharedPointer<QIODevice>( bio, &QObject::deleteLater ); // device audio data gets written to
     m_iodev->open( QIODevice::ReadWrite );
 
+    // start off with whatever parts of the file we streamed before
+    m_cacheKey = StreamCache::key( result );
+    StreamCache::instance()->fill( m_cacheKey, bio );
+
     Servent::instance()->registerStreamConnection( this );
 
     // if the audioengine closes the iodev (skip/stop/etc) then kill the connection
@@ -67,6 +93,41 @@ StreamConnection::StreamConnection( Servent* s, ControlConnection* cc, QString f
 }
 
 
+StreamConnection::StreamConnection( Servent* s, ControlConnection* cc, QString fid, const Tomahawk::result_ptr& result, StreamConnection* swarmOwner )
+    : Connection( s )
+    , m_iodev( swarmOwner->iodevice() )
+    , m_cc( cc )
+    , m_fid( fid )
+    , m_type( RECEIVING )
+    , m_curBlock( 0 )
+    , m_badded( 0 )
+    , m_bsent( 0 )
+    , m_allok( false )
+    , m_result( result )
+    , m_transferRate( 0 )
+    , m_cacheKey( swarmOwner->m_cacheKey )
+    , m_requestedBlock( -1 )
+    , m_peerReady( false )
+    , m_deferredBlock( -1 )
+    , m_swarmHelper( true )
+    , m_sendScheduled( false )
+    , m_keepAlive( false )
+    , m_awaitingFetch( false )
+    , m_pendingSeek( -1 )
+    , m_idleTimer( 0 )
+{
+    qDebug() << Q_FUNC_INFO;
+
+    Servent::instance()->registerStreamConnection( this );
+
+    connect( m_iodev.data(), SIGNAL( aboutToClose() ), SLOT( shutdown() ), Qt::QueuedConnection );
+    connect( this, SIGNAL( finished() ), SLOT( deleteLater() ), Qt::QueuedConnection );
+
+    this->setMsgProcessorModeIn ( MsgProcessor::NOTHING );
+    this->setMsgProcessorModeOut( MsgProcessor::NOTHING );
+}
+
+
 StreamConnection::StreamConnection( Servent* s, ControlConnection* cc, QString fid )
     : Connection( s )
     , m_cc( cc )
@@ -76,6 +137,15 @@ StreamConnection::StreamConnection( Servent* s, ControlConnection* cc, QString f
     , m_bsent( 0 )
     , m_allok( false )
     , m_transferRate( 0 )
+    , m_requestedBlock( -1 )
+    , m_peerReady( false )
+    , m_deferredBlock( -1 )
+    , m_swarmHelper( false )
+    , m_sendScheduled( false )
+    , m_keepAlive( false )
+    , m_awaitingFetch( false )
+    , m_pendingSeek( -1 )
+    , m_idleTimer( 0 )
 {
     Servent::instance()->registerStreamConnection( this );
     // auto delete when connection closes:
@@ -86,7 +156,20 @@ StreamConnection::StreamConnection( Servent* s, ControlConnection* cc, QString f
 StreamConnection::~StreamConnection()
 {
     qDebug() << Q_FUNC_INFO << "TX/RX:" << bytesSent() << bytesReceived();
-    if( m_type == RECEIVING && !m_allok )
+
+    // before anything else, so the scheduler can't hand us another block meanwhile
+    UploadScheduler::instance()->remove( this );
+    Servent::instance()->unparkStream( this );
+
+    // the transfer lives as long as its first connection, helpers just speed it up
+    foreach ( const QPointer<StreamConnection>& helper, m_swarmHelpers )
+    {
+        // helpers may run in another network thread
+        if ( !helper.isNull() )
+            QMetaObject::invokeMethod( helper.data(), "shutdown", Qt::QueuedConnection );
+    }
+
+    if( m_type == RECEIVING && !m_allok && !m_swarmHelper )
     {
         qDebug() << "FTConnection closing before last data msg received, shame.";
         //TODO log the fact that our peer was bad-mannered enough to not finish the upload
@@ -94,9 +177,14 @@ StreamConnection::~StreamConnection()
         // protected, we could expose it:
         //m_iodev->setErrorString("FTConnection providing data went away mid-transfer");
 
-        ((BufferIODevice*)m_iodev.data())->inputComplete();
+        if ( !m_iodev.isNull() )
+            ((BufferIODevice*)m_iodev.data())->inputComplete();
     }
 
+    // we went away before resume() took over the next file
+    if ( !m_nextIodev.isNull() )
+        ((BufferIODevice*)m_nextIodev.data())->inputComplete();
+
     Servent::instance()->onStreamFinished( this );
 }
 
@@ -128,6 +216,7 @@ StreamConnection::showStats( qint64 tx, qint64 rx )
 
     m_transferRate = tx + rx;
     emit updated();
+    emit transferRateChanged( this, m_transferRate );
 }
 
 
@@ -152,6 +241,31 @@ StreamConnection::setup()
     if( m_type == RECEIVING )
     {
         qDebug() << "in RX mode";
+
+        // older peers crash on a block request that arrives before they opened the file
+        m_peerReady = m_cc && m_cc->peerSupports( "streamblocks" );
+
+        BufferIODevice* bio = (BufferIODevice*)m_iodev.data();
+        if ( m_swarmHelper )
+        {
+            // take over the second half of the biggest part nobody got yet
+            if ( bio->splitBlock() < 0 )
+            {
+                shutdown();
+                return;
+            }
+
+            requestBlock( bio->splitBlock() );
+        }
+        else if ( !bio->isBlockEmpty( 0 ) && bio->nextEmptyBlock() >= 0 )
+        {
+            // skip the blocks we already got from the stream cache
+            requestBlock( bio->nextEmptyBlock() );
+        }
+
+        if ( !m_swarmHelper )
+            startSwarm();
+
         emit updated();
         return;
     }
@@ -186,7 +300,20 @@ StreamConnection::startSending( const Tomahawk::result_ptr& result )
     }
 
     m_readdev = QSharedPointer<QIODevice>( io );
-    sendSome();
+    setUploadScheduled( true );
+    connect( m_sock.data(), SIGNAL( bytesWritten( qint64 ) ), SLOT( onBytesWritten() ),
+             (Qt::ConnectionType)( Qt::QueuedConnection | Qt::UniqueConnection ) );
+
+    // tell the peer it may ask for its next file over this connection. Older peers ignore it
+    sendMsg( Msg::factory( "keepalive", Msg::RAW | Msg::FRAGMENT ) );
+
+    if ( m_pendingSeek >= 0 )
+    {
+        seekTo( m_pendingSeek );
+        m_pendingSeek = -1;
+    }
+
+    scheduleSend();
 
     emit updated();
 }
@@ -197,47 +324,230 @@ StreamConnection::handleMsg( msg_ptr msg )
 {
     Q_ASSERT( msg->is( Msg::RAW ) );
 
-    if ( msg->payload().startsWith( "block" ) )
+    if ( m_type == SENDING )
+    {
+        if ( msg->payload().startsWith( "block" ) )
+        {
+            int block = QString( msg->payload() ).mid( 5 ).toInt();
+            if ( m_readdev.isNull() )
+            {
+                // still loading the file, startSending() seeks for us
+                m_pendingSeek = block;
+                return;
+            }
+
+            seekTo( block );
+            scheduleSend();
+        }
+        else if ( msg->payload() == "idle" )
+        {
+            // the peer got everything, nothing to show for us until it asks for more
+            UploadScheduler::instance()->remove( this );
+            m_sendScheduled = false;
+            m_readdev.clear();
+            Servent::instance()->onStreamFinished( this );
+        }
+        else if ( msg->payload().startsWith( "fetch" ) )
+        {
+            // the peer got the last file and wants the next one over this connection
+            UploadScheduler::instance()->remove( this );
+            Servent::instance()->onStreamFinished( this );
+
+            m_fid = QString( msg->payload() ).mid( 5 );
+            m_readdev.clear();
+            m_result.clear();
+            m_sendScheduled = false;
+            m_pendingSeek = -1;
+            m_bsent = 0;
+
+            Servent::instance()->registerStreamConnection( this );
+
+            // everything after this belongs to the new file
+            QByteArray sm;
+            sm.append( QString( "fetchok%1" ).arg( m_fid ) );
+            sendMsg( Msg::factory( sm, Msg::RAW | Msg::FRAGMENT ) );
+
+            DatabaseCommand_LoadFiles* cmd = new DatabaseCommand_LoadFiles( m_fid.toUInt() );
+            connect( cmd, SIGNAL( result( Tomahawk::result_ptr ) ), SLOT( startSending( Tomahawk::result_ptr ) ) );
+            Database::instance()->enqueue( QSharedPointer<DatabaseCommand>( cmd ) );
+        }
+        return;
+    }
+
+    if ( msg->payload() == "keepalive" )
+    {
+        m_keepAlive = true;
+        peerReady();
+        return;
+    }
+    else if ( msg->payload().startsWith( "fetchok" ) )
     {
-        int block = QString( msg->payload() ).mid( 5 ).toInt();
-        m_readdev->seek( block * BufferIODevice::blockSize() );
+        m_awaitingFetch = false;
+        return;
+    }
 
-        qDebug() << "Seeked to block:" << block;
+    // parked, or still getting the tail of the previous file
+    if ( m_awaitingFetch || m_iodev.isNull() )
+        return;
 
-        QByteArray sm;
-        sm.append( QString( "doneblock%1" ).arg( block ) );
+    // the peer is sending, so it has the file open by now
+    peerReady();
 
-        sendMsg( Msg::factory( sm, Msg::RAW | Msg::FRAGMENT ) );
-        QTimer::singleShot( 0, this, SLOT( sendSome() ) );
-    }
-    else if ( msg->payload().startsWith( "doneblock" ) )
+    if ( msg->payload().startsWith( "doneblock" ) )
     {
         int block = QString( msg->payload() ).mid( 9 ).toInt();
         ((BufferIODevice*)m_iodev.data())->seeked( block );
 
         m_curBlock = block;
+        if ( m_requestedBlock == block )
+            m_requestedBlock = -1;
         qDebug() << "Next block is now:" << block;
     }
     else if ( msg->payload().startsWith( "data" ) )
     {
         m_badded += msg->payload().length() - 4;
-        ((BufferIODevice*)m_iodev.data())->addData( m_curBlock++, msg->payload().mid( 4 ) );
+
+        const QByteArray data = msg->payload().mid( 4 );
+        StreamCache::instance()->addBlock( m_cacheKey, m_result->size(), m_curBlock, data );
+        ((BufferIODevice*)m_iodev.data())->addData( m_curBlock++, data );
     }
 
     //qDebug() << Q_FUNC_INFO << "flags" << (int) msg->flags()
     //         << "payload len" << msg->payload().length()
     //         << "written to device so far: " << m_badded;
 
-    if ( ((BufferIODevice*)m_iodev.data())->nextEmptyBlock() < 0 )
+    BufferIODevice* bio = (BufferIODevice*)m_iodev.data();
+    if ( bio->nextEmptyBlock() < 0 )
     {
         m_allok = true;
         // tell our iodev there is no more data to read, no args meaning a success:
-        ((BufferIODevice*)m_iodev.data())->inputComplete();
-        shutdown();
+        bio->inputComplete();
+
+        if ( m_keepAlive && !m_swarmHelper )
+            park();
+        else
+            shutdown();
+    }
+    else if ( m_requestedBlock < 0 && ( m_curBlock >= bio->maxBlocks() || !bio->isBlockEmpty( m_curBlock ) ) )
+    {
+        // reached the end or another peer got here first, move on to a part that is still missing
+        requestBlock( m_swarmHelper ? bio->splitBlock() : bio->nextEmptyBlock() );
     }
 }
 
 
+void
+StreamConnection::seekTo( int block )
+{
+    m_readdev->seek( block * BufferIODevice::blockSize() );
+
+    qDebug() << "Seeked to block:" << block;
+
+    QByteArray sm;
+    sm.append( QString( "doneblock%1" ).arg( block ) );
+
+    sendMsg( Msg::factory( sm, Msg::RAW | Msg::FRAGMENT ) );
+}
+
+
+void
+StreamConnection::park()
+{
+    qDebug() << Q_FUNC_INFO << id();
+
+    foreach ( const QPointer<StreamConnection>& helper, m_swarmHelpers )
+    {
+        if ( !helper.isNull() )
+            QMetaObject::invokeMethod( helper.data(), "shutdown", Qt::QueuedConnection );
+    }
+    m_swarmHelpers.clear();
+
+    // the audio engine closing this file must not take the connection down with it anymore
+    disconnect( m_iodev.data(), 0, this, 0 );
+    m_iodev.clear();
+    m_awaitingFetch = true;
+
+    sendMsg( Msg::factory( "idle", Msg::RAW | Msg::FRAGMENT ) );
+
+    if ( !m_idleTimer )
+    {
+        m_idleTimer = new QTimer( this );
+        m_idleTimer->setSingleShot( true );
+        m_idleTimer->setInterval( STREAM_IDLE_TIMEOUT );
+        connect( m_idleTimer, SIGNAL( timeout() ), SLOT( onIdleTimeout() ) );
+    }
+    m_idleTimer->start();
+
+    Servent::instance()->parkStream( this );
+}
+
+
+void
+StreamConnection::onIdleTimeout()
+{
+    // nobody took us in the meantime
+    if ( Servent::instance()->unparkStream( this ) )
+        shutdown();
+}
+
+
+QSharedPointer<QIODevice>
+StreamConnection::reuse( const QString& fid, const Tomahawk::result_ptr& result )
+{
+    BufferIODevice* bio = new BufferIODevice( result->size() );
+    QSharedPointer<QIODevice> iodev( bio, &QObject::deleteLater );
+    iodev->open( QIODevice::ReadWrite );
+    StreamCache::instance()->fill( StreamCache::key( result ), bio );
+
+    m_nextFid = fid;
+    m_nextResult = result;
+    m_nextIodev = iodev;
+
+    QMetaObject::invokeMethod( this, "resume", Qt::QueuedConnection );
+    return iodev;
+}
+
+
+void
+StreamConnection::resume()
+{
+    if ( m_nextIodev.isNull() )
+        return;
+
+    if ( m_idleTimer )
+        m_idleTimer->stop();
+
+    m_fid = m_nextFid;
+    m_result = m_nextResult;
+    m_iodev = m_nextIodev;
+    m_nextIodev.clear();
+    m_nextResult.clear();
+
+    m_cacheKey = StreamCache::key( m_result );
+    m_curBlock = 0;
+    m_badded = 0;
+    m_allok = false;
+    m_requestedBlock = -1;
+
+    qDebug() << Q_FUNC_INFO << id();
+    Servent::instance()->registerStreamConnection( this );
+
+    connect( m_iodev.data(), SIGNAL( aboutToClose() ), SLOT( shutdown() ), Qt::QueuedConnection );
+    connect( m_iodev.data(), SIGNAL( blockRequest( int ) ), SLOT( onBlockRequest( int ) ) );
+
+    QByteArray sm;
+    sm.append( QString( "fetch%1" ).arg( m_fid ) );
+    sendMsg( Msg::factory( sm, Msg::RAW | Msg::FRAGMENT ) );
+
+    BufferIODevice* bio = (BufferIODevice*)m_iodev.data();
+    if ( !bio->isBlockEmpty( 0 ) && bio->nextEmptyBlock() >= 0 )
+        requestBlock( bio->nextEmptyBlock() );
+
+    startSwarm();
+    emit updated();
+}
+
+
 Connection*
 StreamConnection::clone()
 {
@@ -246,29 +556,58 @@ StreamConnection::clone()
 }
 
 
+void
+StreamConnection::scheduleSend()
+{
+    if ( m_sendScheduled || m_readdev.isNull() || m_readdev->atEnd() )
+        return;
+
+    if ( m_sock.isNull() || m_sock->bytesToWrite() > MAX_BUFFERED_BLOCKS * BufferIODevice::blockSize() )
+        return; // onBytesWritten() tries again
+
+    m_sendScheduled = true;
+    UploadScheduler::instance()->request( this, m_sock->peerAddress().toString(), Msg::headerSize() + 4 + BufferIODevice::blockSize() );
+}
+
+
+void
+StreamConnection::onBytesWritten()
+{
+    scheduleSend();
+}
+
+
 void
 StreamConnection::sendSome()
 {
     Q_ASSERT( m_type == StreamConnection::SENDING );
+    m_sendScheduled = false;
+
+    // the peer moved on to another file meanwhile
+    if ( m_readdev.isNull() )
+        return;
+
+    // read the block straight into the msg frame, behind the "data" marker
+    QByteArray frame = Msg::frameBuffer( 4 + BufferIODevice::blockSize() );
+    char* payload = frame.data() + Msg::headerSize();
+    memcpy( payload, "data", 4 );
 
-    QByteArray ba = "data";
-    ba.append( m_readdev->read( BufferIODevice::blockSize() ) );
-    m_bsent += ba.length() - 4;
+    const qint64 len = qMax( (qint64)0, m_readdev->read( payload + 4, BufferIODevice::blockSize() ) );
+    frame.resize( Msg::headerSize() + 4 + len );
+    m_bsent += len;
 
     if( m_readdev->atEnd() )
     {
-        sendMsg( Msg::factory( ba, Msg::RAW ) );
+        sendMsg( Msg::fromFrame( frame, Msg::RAW ) );
         return;
     }
     else
     {
         // more to come -> FRAGMENT
-        sendMsg( Msg::factory( ba, Msg::RAW | Msg::FRAGMENT ) );
+        sendMsg( Msg::fromFrame( frame, Msg::RAW | Msg::FRAGMENT ) );
     }
 
-    // HINT: change the 0 to 50 to transmit at 640Kbps, for example
-    //       (this is where upload throttling could be implemented)
-    QTimer::singleShot( 0, this, SLOT( sendSome() ) );
+    scheduleSend();
 }
 
 
@@ -280,8 +619,87 @@ StreamConnection::onBlockRequest( int block )
     if ( m_curBlock == block )
         return;
 
+    requestBlock( block );
+}
+
+
+void
+StreamConnection::requestBlock( int block )
+{
+    if ( block < 0 )
+        return;
+
+    m_requestedBlock = block;
+    if ( !m_peerReady )
+    {
+        m_deferredBlock = block;
+        return;
+    }
+
     QByteArray sm;
     sm.append( QString( "block%1" ).arg( block ) );
 
     sendMsg( Msg::factory( sm, Msg::RAW | Msg::FRAGMENT ) );
 }
+
+
+void
+StreamConnection::peerReady()
+{
+    if ( m_peerReady )
+        return;
+
+    m_peerReady = true;
+    if ( m_deferredBlock >= 0 )
+    {
+        const int block = m_deferredBlock;
+        m_deferredBlock = -1;
+        requestBlock( block );
+    }
+}
+
+
+void
+StreamConnection::startSwarm()
+{
+    if ( m_result.isNull() || m_result->size() < SWARM_MIN_SIZE )
+        return;
+
+    source_ptr s = source();
+    if ( s.isNull() )
+        return;
+
+    DatabaseCommand_IdenticalFiles* cmd = new DatabaseCommand_IdenticalFiles( s, m_fid );
+    connect( cmd, SIGNAL( done( QStringList ) ), SLOT( onIdenticalFiles( QStringList ) ) );
+    Database::instance()->enqueue( QSharedPointer<DatabaseCommand>( cmd ) );
+}
+
+
+void
+StreamConnection::onIdenticalFiles( const QStringList& urls )
+{
+    if ( m_allok )
+        return;
+
+    foreach ( const QString& url, urls )
+    {
+        if ( m_swarmHelpers.count() >= SWARM_MAX_HELPERS )
+            break;
+
+        QStringList parts = url.mid( QString( "servent://" ).length() ).split( "\t" );
+        source_ptr s = SourceList::instance()->get( parts.at( 0 ) );
+        if ( s.isNull() || !s->controlConnection() || s->controlConnection() == m_cc )
+            continue;
+
+        // helpers start with a block request, older peers can't take that
+        if ( !s->controlConnection()->peerSupports( "streamblocks" ) )
+            continue;
+
+        tDebug() << "Fetching parts of" << m_fid << "from" << s->friendlyName() << "as well";
+
+        ControlConnection* cc = s->controlConnection();
+        StreamConnection* sc = new StreamConnection( m_servent, cc, parts.at( 1 ), m_result, this );
+        m_swarmHelpers << QPointer<StreamConnection>( sc );
+        m_servent->createParallelConnection( cc, sc, QString( "FILE_REQUEST_KEY:%1" ).arg( parts.at( 1 ) ) );
+    }
+}
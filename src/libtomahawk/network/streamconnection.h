@@ -22,6 +22,8 @@
 #include <QObject>
 #include <QSharedPointer>
 #include <QIODevice>
+#include <QPointer>
+#include <QTimer>
 
 #include "network/connection.h"
 #include "result.h"
@@ -44,6 +46,8 @@ public:
 
     // RX:
     explicit StreamConnection( Servent* s, ControlConnection* cc, QString fid, const Tomahawk::result_ptr& result );
+    // RX, helping another connection by fetching parts of the same file from a different peer:
+    explicit StreamConnection( Servent* s, ControlConnection* cc, QString fid, const Tomahawk::result_ptr& result, StreamConnection* swarmOwner );
     // TX:
     explicit StreamConnection( Servent* s, ControlConnection* cc, QString fid );
 
@@ -63,8 +67,13 @@ public:
     Type type() const { return m_type; }
     QString fid() const { return m_fid; }
 
+    // RX, picks up an idle connection from the pool for the next file of the same peer.
+    // Only call through Servent::reuseParkedStream(), which keeps us from being deleted meanwhile
+    QSharedPointer<QIODevice> reuse( const QString& fid, const Tomahawk::result_ptr& result );
+
 signals:
     void updated();
+    void transferRateChanged( StreamConnection* sc, qint64 transferRate );
 
 protected slots:
     virtual void handleMsg( msg_ptr msg );
@@ -75,8 +84,25 @@ private slots:
     void showStats( qint64 tx, qint64 rx );
 
     void onBlockRequest( int pos );
+    void onIdenticalFiles( const QStringList& urls );
+    void onBytesWritten();
+
+    void resume();
+    void onIdleTimeout();
 
 private:
+    void requestBlock( int block );
+    // RX, the peer can take block requests now, send the one we held back
+    void peerReady();
+    // TX, continue reading at block and let the peer know
+    void seekTo( int block );
+    // asks the UploadScheduler for the next block, unless the socket is still busy with the last ones
+    void scheduleSend();
+    // fetch parts of big files from other peers that have an identical copy too
+    void startSwarm();
+    // transfer is done but the peer keeps the connection open, wait for the next file
+    void park();
+
     QSharedPointer<QIODevice> m_iodev;
     ControlConnection* m_cc;
     QString m_fid;
@@ -91,6 +117,25 @@ private:
     Tomahawk::source_ptr m_source;
     Tomahawk::result_ptr m_result;
     qint64 m_transferRate;
+
+    QString m_cacheKey;
+
+    int m_requestedBlock;
+    bool m_peerReady; // RX: peer takes block requests before it sent us anything
+    int m_deferredBlock; // RX: block request held back until then
+    bool m_swarmHelper;
+    bool m_sendScheduled;
+    QList< QPointer<StreamConnection> > m_swarmHelpers;
+
+    bool m_keepAlive; // RX: peer serves more files over this connection
+    bool m_awaitingFetch; // RX: drop leftovers until the peer acknowledged the new file
+    int m_pendingSeek; // TX: block requested before the file was loaded
+    QTimer* m_idleTimer;
+
+    // handed over by reuse(), picked up by resume() in our own thread
+    QString m_nextFid;
+    Tomahawk::result_ptr m_nextResult;
+    QSharedPointer<QIODevice> m_nextIodev;
 };
 
 #endif // STREAMCONNECTION_H
@@ -0,0 +1,217 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Copyright 2010-2011, Christian Muehlhaeuser <muesli@tomahawk-player.org>
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "uploadscheduler.h"
+
+#include <QtCore/QMutexLocker>
+
+#include "streamconnection.h"
+#include "tomahawksettings.h"
+#include "utils/logger.h"
+
+// how often we refill the buckets while streams are waiting
+#define TICK_INTERVAL 20
+
+// buckets hold this much time worth of tokens, so short stalls can be caught up on
+#define BURST_MS 250
+
+UploadScheduler* UploadScheduler::s_instance = 0;
+
+
+UploadScheduler*
+UploadScheduler::instance()
+{
+    return s_instance;
+}
+
+
+UploadScheduler::UploadScheduler( QObject* parent )
+    : QObject( parent )
+    , m_rate( 0 )
+    , m_peerRate( 0 )
+    , m_tokens( 0 )
+{
+    s_instance = this;
+
+    m_lastRefill.start();
+
+    m_timer.setInterval( TICK_INTERVAL );
+    m_timer.setSingleShot( true );
+    connect( &m_timer, SIGNAL( timeout() ), SLOT( dispatch() ) );
+
+    connect( TomahawkSettings::instance(), SIGNAL( changed() ), SLOT( onSettingsChanged() ) );
+    onSettingsChanged();
+}
+
+
+UploadScheduler::~UploadScheduler()
+{
+    s_instance = 0;
+}
+
+
+void
+UploadScheduler::setRates( qint64 total, qint64 perPeer )
+{
+    QMutexLocker lock( &m_mutex );
+    if ( total == m_rate && perPeer == m_peerRate )
+        return;
+
+    tDebug() << Q_FUNC_INFO << "Upload limits:" << total << "bytes/sec total," << perPeer << "bytes/sec per peer";
+    m_rate = qMax( (qint64)0, total );
+    m_peerRate = qMax( (qint64)0, perPeer );
+    m_tokens = 0;
+    m_peerTokens.clear();
+}
+
+
+void
+UploadScheduler::onSettingsChanged()
+{
+    TomahawkSettings* s = TomahawkSettings::instance();
+    setRates( (qint64)s->uploadRateLimit() * 1024, (qint64)s->peerUploadRateLimit() * 1024 );
+}
+
+
+void
+UploadScheduler::request( StreamConnection* sc, const QString& peer, int bytes )
+{
+    QMutexLocker lock( &m_mutex );
+
+    // nothing to ration, don't bother our thread with it
+    if ( !m_rate && !m_peerRate )
+    {
+        QMetaObject::invokeMethod( sc, "sendSome", Qt::QueuedConnection );
+        return;
+    }
+
+    Request r;
+    r.sc = sc;
+    r.peer = peer;
+    r.bytes = bytes;
+    m_waiting << r;
+
+    // the first one in line kicks off dispatching, the timer keeps it going from there
+    if ( m_waiting.count() == 1 )
+        QMetaObject::invokeMethod( this, "dispatch", Qt::QueuedConnection );
+}
+
+
+void
+UploadScheduler::remove( StreamConnection* sc )
+{
+    QMutexLocker lock( &m_mutex );
+
+    for ( int i = m_waiting.count() - 1; i >= 0; i-- )
+    {
+        if ( m_waiting.at( i ).sc == sc )
+            m_waiting.removeAt( i );
+    }
+}
+
+
+void
+UploadScheduler::consumed( qint64 bytes )
+{
+    QMutexLocker lock( &m_mutex );
+    if ( !m_rate )
+        return;
+
+    // don't let a big dbsync starve the streams for more than a second
+    m_tokens = qMax( m_tokens - bytes, -m_rate );
+}
+
+
+void
+UploadScheduler::refill()
+{
+    const int elapsed = m_lastRefill.restart();
+
+    if ( m_rate )
+    {
+        const qint64 burst = m_rate * BURST_MS / 1000;
+        m_tokens = qMin( m_tokens + m_rate * elapsed / 1000, burst );
+    }
+
+    if ( m_peerRate )
+    {
+        const qint64 burst = m_peerRate * BURST_MS / 1000;
+        QMutableHashIterator< QString, qint64 > it( m_peerTokens );
+        while ( it.hasNext() )
+        {
+            it.next();
+            it.value() = qMin( it.value() + m_peerRate * elapsed / 1000, burst );
+
+            // full buckets of peers we aren't sending to are just clutter
+            if ( it.value() >= burst )
+                it.remove();
+        }
+    }
+}
+
+
+bool
+UploadScheduler::mayGrant( const Request& r ) const
+{
+    // a bucket always lets one request through while it's full, so requests
+    // bigger than the burst size can't get stuck
+    if ( m_rate && m_tokens < qMin( (qint64)r.bytes, m_rate * BURST_MS / 1000 ) )
+        return false;
+
+    if ( m_peerRate && m_peerTokens.contains( r.peer ) &&
+         m_peerTokens.value( r.peer ) < qMin( (qint64)r.bytes, m_peerRate * BURST_MS / 1000 ) )
+        return false;
+
+    return true;
+}
+
+
+void
+UploadScheduler::dispatch()
+{
+    QMutexLocker lock( &m_mutex );
+    refill();
+
+    // one pass in queue order, whoever gets to send queues up at the back again
+    QList< Request > waiting = m_waiting;
+    m_waiting.clear();
+
+    foreach ( const Request& r, waiting )
+    {
+        if ( !mayGrant( r ) )
+        {
+            m_waiting << r;
+            continue;
+        }
+
+        if ( m_rate )
+            m_tokens -= r.bytes;
+        if ( m_peerRate )
+        {
+            if ( !m_peerTokens.contains( r.peer ) )
+                m_peerTokens.insert( r.peer, m_peerRate * BURST_MS / 1000 );
+            m_peerTokens[ r.peer ] -= r.bytes;
+        }
+
+        // streams remove() themselves under our lock before they are destroyed
+        QMetaObject::invokeMethod( r.sc, "sendSome", Qt::QueuedConnection );
+    }
+
+    if ( !m_waiting.isEmpty() )
+        m_timer.start();
+}
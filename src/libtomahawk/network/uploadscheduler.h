@@ -0,0 +1,87 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Copyright 2010-2011, Christian Muehlhaeuser <muesli@tomahawk-player.org>
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef UPLOADSCHEDULER_H
+#define UPLOADSCHEDULER_H
+
+#include <QtCore/QObject>
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QTime>
+#include <QtCore/QTimer>
+
+#include "dllmacro.h"
+
+class StreamConnection;
+
+/**
+ * Token bucket for everything we upload to peers, with an optional bucket per peer.
+ *
+ * Sending StreamConnections request() the bytes they want to put on the wire next
+ * and get their sendSome() slot invoked once they may, in round-robin order.
+ * Control and dbsync traffic is never held back, it is just accounted as consumed()
+ * so the streams get what's left of the budget.
+ *
+ * Threadsafe, streams run in Servent's network threads.
+ */
+class DLLEXPORT UploadScheduler : public QObject
+{
+Q_OBJECT
+
+public:
+    static UploadScheduler* instance();
+
+    explicit UploadScheduler( QObject* parent = 0 );
+    virtual ~UploadScheduler();
+
+    /// bytes per second, 0 means unlimited
+    void setRates( qint64 total, qint64 perPeer );
+
+    void request( StreamConnection* sc, const QString& peer, int bytes );
+    void remove( StreamConnection* sc );
+    void consumed( qint64 bytes );
+
+private slots:
+    void onSettingsChanged();
+    void dispatch();
+
+private:
+    struct Request
+    {
+        StreamConnection* sc;
+        QString peer;
+        int bytes;
+    };
+
+    void refill();
+    bool mayGrant( const Request& r ) const;
+
+    QMutex m_mutex;
+    QList< Request > m_waiting;
+
+    qint64 m_rate, m_peerRate;
+    qint64 m_tokens;
+    QHash< QString, qint64 > m_peerTokens;
+    QTime m_lastRefill;
+
+    QTimer m_timer;
+
+    static UploadScheduler* s_instance;
+};
+
+#endif // UPLOADSCHEDULER_H
@@ -33,6 +33,17 @@
 #define CLEANUP_TIMEOUT 5 * 60 * 1000
 #define MINSCORE 0.5
 
+// dispatch shares per round of the weighted fair scheduler
+#define INTERACTIVE_WEIGHT 8
+#define NORMAL_WEIGHT 3
+#define BACKGROUND_WEIGHT 1
+
+// background queries leave this many slots free, interactive ones may use this many extra
+#define BACKGROUND_RESERVED_SLOTS 2
+#define INTERACTIVE_EXTRA_SLOTS 2
+
+static const int s_weights[] = { BACKGROUND_WEIGHT, NORMAL_WEIGHT, INTERACTIVE_WEIGHT };
+
 using namespace Tomahawk;
 
 Pipeline* Pipeline::s_instance = 0;
@@ -52,6 +63,8 @@ Pipeline::Pipeline( QObject* parent )
     s_instance = this;
 
     m_maxConcurrentQueries = qBound( DEFAULT_CONCURRENT_QUERIES, QThread::idealThreadCount(), MAX_CONCURRENT_QUERIES );
+    for ( int i = BackgroundPriority; i <= InteractivePriority; i++ )
+        m_credits[ i ] = s_weights[ i ];
     tDebug() << Q_FUNC_INFO << "Using" << m_maxConcurrentQueries << "threads";
 
     m_temporaryQueryTimer.setInterval( CLEANUP_TIMEOUT );
@@ -81,7 +94,7 @@ Pipeline::databaseReady()
 void
 Pipeline::start()
 {
-    tDebug() << Q_FUNC_INFO << "Shunting this many pending queries:" << m_queries_pending.size();
+    tDebug() << Q_FUNC_INFO << "Shunting this many pending queries:" << m_qidsPending.count();
     m_running = true;
 
     shuntNext();
@@ -189,6 +202,34 @@ Pipeline::resolverForPath( const QString& scriptPath )
 
 void
 Pipeline::resolve( const QList<query_ptr>& qlist, bool prioritized, bool temporaryQuery )
+{
+    // the old API: prioritized just means first in line
+    enqueue( qlist, NormalPriority, prioritized, temporaryQuery );
+}
+
+
+void
+Pipeline::resolve( const QList<query_ptr>& qlist, Priority priority, bool temporaryQuery )
+{
+    // the newest interactive request is the one the user is waiting for
+    enqueue( qlist, priority, priority == InteractivePriority, temporaryQuery );
+}
+
+
+void
+Pipeline::resolve( const query_ptr& q, Priority priority, bool temporaryQuery )
+{
+    if ( q.isNull() )
+        return;
+
+    QList< query_ptr > qlist;
+    qlist << q;
+    resolve( qlist, priority, temporaryQuery );
+}
+
+
+void
+Pipeline::enqueue( const QList<query_ptr>& qlist, Priority priority, bool front, bool temporaryQuery )
 {
     {
         QMutexLocker lock( &m_mut );
@@ -196,20 +237,28 @@ Pipeline::resolve( const QList<query_ptr>& qlist, bool prioritized, bool tempora
         int i = 0;
         foreach( const query_ptr& q, qlist )
         {
-            if ( q->resolvingFinished() )
-                continue;
-            if ( m_queries_pending.contains( q ) )
+            if ( q.isNull() || q->resolvingFinished() )
                 continue;
             if ( m_qidsState.contains( q->id() ) )
                 continue;
+            if ( m_qidsPending.contains( q->id() ) )
+            {
+                // already waiting, but maybe it just got more important
+                const int pending = m_qidsPending.value( q->id() );
+                if ( pending >= priority )
+                    continue;
+
+                m_queries_pending[ pending ].removeAll( q );
+            }
 
             if ( !m_qids.contains( q->id() ) )
                 m_qids.insert( q->id(), q );
 
-            if ( prioritized )
-                m_queries_pending.insert( i++, q );
+            m_qidsPending.insert( q->id(), priority );
+            if ( front )
+                m_queries_pending[ priority ].insert( i++, q );
             else
-                m_queries_pending << q;
+                m_queries_pending[ priority ] << q;
 
             if ( temporaryQuery )
             {
@@ -245,6 +294,109 @@ Pipeline::resolve( QID qid, bool prioritized, bool temporaryQuery )
 }
 
 
+void
+Pipeline::cancel( const query_ptr& q )
+{
+    if ( q.isNull() )
+        return;
+
+    QList< query_ptr > qlist;
+    qlist << q;
+    cancel( qlist );
+}
+
+
+void
+Pipeline::cancel( const QList<query_ptr>& qlist )
+{
+    QMutexLocker lock( &m_mut );
+
+    foreach( const query_ptr& q, qlist )
+    {
+        if ( q.isNull() || !m_qidsPending.contains( q->id() ) )
+            continue;
+
+        // queries that are already with the resolvers just run to completion
+        m_queries_pending[ m_qidsPending.take( q->id() ) ].removeAll( q );
+        if ( !m_queries_temporary.contains( q ) )
+            m_qids.remove( q->id() );
+    }
+}
+
+
+void
+Pipeline::resolveVisible( const QList<query_ptr>& visible, const QList<query_ptr>& previous )
+{
+    QList< query_ptr > hidden;
+    foreach ( const query_ptr& q, previous )
+    {
+        if ( !q->resolvingFinished() && !visible.contains( q ) )
+            hidden << q;
+    }
+
+    if ( !hidden.isEmpty() )
+    {
+        cancel( hidden );
+        resolve( hidden, BackgroundPriority );
+    }
+    if ( !visible.isEmpty() )
+        resolve( visible, InteractivePriority );
+}
+
+
+bool
+Pipeline::hasFreeSlot( int priority ) const
+{
+    const int active = m_qidsState.count();
+    switch ( priority )
+    {
+        case BackgroundPriority:
+            return active < qMax( 1, m_maxConcurrentQueries - BACKGROUND_RESERVED_SLOTS );
+        case InteractivePriority:
+            return active < m_maxConcurrentQueries + INTERACTIVE_EXTRA_SLOTS;
+        default:
+            return active < m_maxConcurrentQueries;
+    }
+}
+
+
+query_ptr
+Pipeline::takeNextQuery()
+{
+    // weighted round robin: every class gets its share of dispatches per round,
+    // so bulk work can't starve the UI and the UI can't starve bulk work entirely
+    for ( int round = 0; round < 2; round++ )
+    {
+        bool dispatchable = false;
+        for ( int i = InteractivePriority; i >= BackgroundPriority; i-- )
+        {
+            if ( m_queries_pending[ i ].isEmpty() || !hasFreeSlot( i ) )
+                continue;
+
+            dispatchable = true;
+            if ( m_credits[ i ] <= 0 )
+                continue;
+
+            m_credits[ i ]--;
+            query_ptr q = m_queries_pending[ i ].takeFirst();
+            m_qidsPending.remove( q->id() );
+            return q;
+        }
+
+        // all slots are busy: keep what's left of this round for when one frees up,
+        // instead of handing the higher classes a fresh share every time
+        if ( !dispatchable )
+            break;
+
+        // whoever could go has used up its share, start the next round
+        for ( int i = BackgroundPriority; i <= InteractivePriority; i++ )
+            m_credits[ i ] = s_weights[ i ];
+    }
+
+    return query_ptr();
+}
+
+
 void
 Pipeline::reportResults( QID qid, const QList< result_ptr >& results )
 {
@@ -358,22 +510,22 @@ Pipeline::shuntNext()
         QMutexLocker lock( &m_mut );
 
         rc = m_resolvers.count();
-        if ( m_queries_pending.isEmpty() )
+        if ( m_qidsPending.isEmpty() )
         {
             if ( m_qidsState.isEmpty() )
                 emit idle();
             return;
         }
 
-        // Check if we are ready to dispatch more queries
-        if ( m_qidsState.count() >= m_maxConcurrentQueries )
+        // Check if we are ready to dispatch more queries, and which one is next
+        q = takeNextQuery();
+        if ( q.isNull() )
             return;
 
         /*
             Since resolvers are async, we now dispatch to the highest weighted ones
             and after timeout, dispatch to next highest etc, aborting when solved
         */
-        q = m_queries_pending.takeFirst();
         q->setCurrentResolver( 0 );
     }
 
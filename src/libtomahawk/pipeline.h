@@ -43,6 +43,14 @@ class DLLEXPORT Pipeline : public QObject
 Q_OBJECT
 
 public:
+    // pending queries are dispatched by weighted fair share between these classes
+    enum Priority
+    {
+        BackgroundPriority = 0, // imports, charts and other bulk work
+        NormalPriority = 1,
+        InteractivePriority = 2 // searches, the playing track and what the user looks at
+    };
+
     static Pipeline* instance();
 
     explicit Pipeline( QObject* parent = 0 );
@@ -50,7 +58,7 @@ public:
 
     bool isRunning() const { return m_running; }
 
-    unsigned int pendingQueryCount() const { return m_queries_pending.count(); }
+    unsigned int pendingQueryCount() const { return m_qidsPending.count(); }
     unsigned int activeQueryCount() const { return m_qidsState.count(); }
 
     void reportResults( QID qid, const QList< result_ptr >& results );
@@ -81,6 +89,16 @@ public slots:
     void resolve( const query_ptr& q, bool prioritized = true, bool temporaryQuery = false );
     void resolve( const QList<query_ptr>& qlist, bool prioritized = true, bool temporaryQuery = false );
     void resolve( QID qid, bool prioritized = true, bool temporaryQuery = false );
+    void resolve( const query_ptr& q, Tomahawk::Pipeline::Priority priority, bool temporaryQuery = false );
+    void resolve( const QList<query_ptr>& qlist, Tomahawk::Pipeline::Priority priority, bool temporaryQuery = false );
+
+    // drops queries that haven't been dispatched yet, e.g. rows that scrolled out of view
+    void cancel( const query_ptr& q );
+    void cancel( const QList<query_ptr>& qlist );
+
+    // for views: bumps the unresolved queries now on screen, and sends the
+    // ones from the previous call that aren't anymore to the back of the line
+    void resolveVisible( const QList<query_ptr>& visible, const QList<query_ptr>& previous );
 
     void start();
     void stop();
@@ -103,6 +121,10 @@ private slots:
 private:
     Tomahawk::Resolver* nextResolver( const Tomahawk::query_ptr& query ) const;
 
+    void enqueue( const QList<query_ptr>& qlist, Priority priority, bool front, bool temporaryQuery );
+    query_ptr takeNextQuery();
+    bool hasFreeSlot( int priority ) const;
+
     void setQIDState( const Tomahawk::query_ptr& query, int state );
     int incQIDState( const Tomahawk::query_ptr& query );
     int decQIDState( const Tomahawk::query_ptr& query );
@@ -118,7 +140,9 @@ private:
     QMutex m_mut; // for m_qids, m_rids
 
     // store queries here until DB index is loaded, then shunt them all
-    QList< query_ptr > m_queries_pending;
+    QList< query_ptr > m_queries_pending[ InteractivePriority + 1 ];
+    QMap< QID, int > m_qidsPending; // priority of each pending query
+    int m_credits[ InteractivePriority + 1 ];
     // store temporary queries here and clean up after timeout threshold
     QList< query_ptr > m_queries_temporary;
 
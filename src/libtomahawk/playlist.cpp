@@ -475,7 +475,8 @@ Playlist::resolve()
         qlist << p->query();
     }
 
-    Pipeline::instance()->resolve( qlist );
+    // views showing the playlist bump the rows they display
+    Pipeline::instance()->resolve( qlist, Pipeline::BackgroundPriority );
 }
 
 
@@ -20,6 +20,10 @@
 #include "tomahawksettings.h"
 #include "XspfUpdater.h"
 
+// spread updates of many subscribed playlists, instead of firing them all at once
+#define UPDATE_JITTER_PERCENT 10
+#define MAX_INITIAL_UPDATE_DELAY 60 * 1000
+
 using namespace Tomahawk;
 
 PlaylistUpdaterInterface*
@@ -55,13 +59,14 @@ PlaylistUpdaterInterface::loadForPlaylist( const playlist_ptr& pl )
 PlaylistUpdaterInterface::PlaylistUpdaterInterface( const playlist_ptr& pl )
     : QObject( 0 )
     , m_timer( new QTimer( this ) )
+    , m_interval( 0 )
     , m_autoUpdate( true )
     , m_playlist( pl )
 {
     Q_ASSERT( !m_playlist.isNull() );
 
     m_playlist->setUpdater( this );
-    connect( m_timer, SIGNAL( timeout() ), this, SLOT( updateNow() ) );
+    connect( m_timer, SIGNAL( timeout() ), this, SLOT( onTimeout() ) );
 
     QTimer::singleShot( 0, this, SLOT( doSave() ) );
 }
@@ -69,14 +74,15 @@ PlaylistUpdaterInterface::PlaylistUpdaterInterface( const playlist_ptr& pl )
 PlaylistUpdaterInterface::PlaylistUpdaterInterface( const playlist_ptr& pl, int interval, bool autoUpdate )
     : QObject( 0 )
     , m_timer( new QTimer( this ) )
+    , m_interval( interval )
     , m_autoUpdate( autoUpdate )
     , m_playlist( pl )
 {
     Q_ASSERT( !m_playlist.isNull() );
 
     m_playlist->setUpdater( this );
-    m_timer->setInterval( interval );
-    connect( m_timer, SIGNAL( timeout() ), this, SLOT( updateNow() ) );
+    m_timer->setInterval( jitteredInterval() );
+    connect( m_timer, SIGNAL( timeout() ), this, SLOT( onTimeout() ) );
 
     QTimer::singleShot( 0, this, SLOT( doSave() ) );
 }
@@ -91,7 +97,7 @@ PlaylistUpdaterInterface::doSave()
     {
         s->setValue( QString( "%1/type" ).arg( key ), type() );
         s->setValue( QString( "%1/autoupdate" ).arg( key ), m_autoUpdate );
-        s->setValue( QString( "%1/interval" ).arg( key ), m_timer->interval() );
+        s->setValue( QString( "%1/interval" ).arg( key ), m_interval );
         saveToSettings( key );
     }
 }
@@ -125,9 +131,9 @@ PlaylistUpdaterInterface::setAutoUpdate( bool autoUpdate )
     const QString key = QString( "playlistupdaters/%1/autoupdate" ).arg( m_playlist->guid() );
     TomahawkSettings::instance()->setValue( key, m_autoUpdate );
 
-    // Update immediately as well
+    // Update soon as well, but don't let all playlists loaded at startup hit the network at once
     if ( m_autoUpdate )
-        QTimer::singleShot( 0, this, SLOT( updateNow() ) );
+        QTimer::singleShot( qrand() % qMax( 1, qMin( m_interval / 10, MAX_INITIAL_UPDATE_DELAY ) ), this, SLOT( updateNow() ) );
 }
 
 void
@@ -136,6 +142,27 @@ PlaylistUpdaterInterface::setInterval( int intervalMsecs )
     const QString key = QString( "playlistupdaters/%1/interval" ).arg( m_playlist->guid() );
     TomahawkSettings::instance()->setValue( key, intervalMsecs );
 
-    m_timer->setInterval( intervalMsecs );
+    m_interval = intervalMsecs;
+    m_timer->setInterval( jitteredInterval() );
+}
+
+
+int
+PlaylistUpdaterInterface::jitteredInterval() const
+{
+    const int jitter = m_interval * UPDATE_JITTER_PERCENT / 100;
+    if ( jitter <= 0 )
+        return m_interval;
+
+    return m_interval - jitter + qrand() % ( 2 * jitter + 1 );
+}
+
+
+void
+PlaylistUpdaterInterface::onTimeout()
+{
+    // pick a new spot in the window every time, so updaters that happened to line up drift apart again
+    m_timer->setInterval( jitteredInterval() );
+    updateNow();
 }
 
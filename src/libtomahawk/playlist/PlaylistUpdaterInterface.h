@@ -48,7 +48,7 @@ public:
     void setAutoUpdate( bool autoUpdate );
 
     void setInterval( int intervalMsecs ) ;
-    int intervalMsecs() const { return m_timer->interval(); }
+    int intervalMsecs() const { return m_interval; }
 
     void remove();
 
@@ -63,6 +63,7 @@ public slots:
 
 private slots:
     void doSave();
+    void onTimeout();
 
 protected:
     virtual void loadFromSettings( const QString& group ) = 0;
@@ -70,7 +71,10 @@ protected:
     virtual void removeFromSettings( const QString& group ) const = 0;
 
 private:
+    int jitteredInterval() const;
+
     QTimer* m_timer;
+    int m_interval;
     bool m_autoUpdate;
     playlist_ptr m_playlist;
 };
@@ -23,6 +23,7 @@
 #include "tomahawksettings.h"
 #include "pipeline.h"
 #include "utils/tomahawkutils.h"
+#include "utils/logger.h"
 
 #include <QTimer>
 
@@ -57,41 +58,68 @@ XspfUpdater::updateNow()
 {
     XSPFLoader* l = new XSPFLoader( false, false );
     l->setAutoResolveTracks( false );
+    l->setConditionalFetch( m_etag, m_lastModified, m_bodyHash );
+    connect( l, SIGNAL( tracks( QList<Tomahawk::query_ptr> ) ), this, SLOT( playlistLoaded( QList<Tomahawk::query_ptr> ) ) );
     l->load( m_url );
-    connect( l, SIGNAL( ok ( Tomahawk::playlist_ptr ) ), this, SLOT( playlistLoaded() ) );
 }
 
 void
-XspfUpdater::playlistLoaded()
+XspfUpdater::playlistLoaded( const QList< Tomahawk::query_ptr >& newTracks )
 {
     XSPFLoader* loader = qobject_cast<XSPFLoader*>( sender() );
     Q_ASSERT( loader );
 
+    m_etag = loader->etag();
+    m_lastModified = loader->lastModified();
+    m_bodyHash = loader->bodyHash();
+    saveToSettings( settingsKey() );
+
     QList< query_ptr > tracks;
     foreach ( const plentry_ptr ple, playlist()->entries() )
         tracks << ple->query();
 
-    QList< query_ptr > mergedTracks = TomahawkUtils::mergePlaylistChanges( tracks, loader->entries() );
+    bool changed = false;
+    QList< query_ptr > mergedTracks = TomahawkUtils::mergePlaylistChanges( tracks, newTracks, &changed );
+    if ( !changed )
+    {
+        tDebug() << "No changes in xspf playlist, not creating a new revision:" << m_url;
+        return;
+    }
 
     QList<Tomahawk::plentry_ptr> el = playlist()->entriesFromQueries( mergedTracks, true );
     playlist()->createNewRevision( uuid(), playlist()->currentrevision(), el );
 
 }
 
+QString
+XspfUpdater::settingsKey() const
+{
+    return QString( "playlistupdaters/%1" ).arg( playlist()->guid() );
+}
+
 void
 XspfUpdater::saveToSettings( const QString& group ) const
 {
     TomahawkSettings::instance()->setValue( QString( "%1/xspfurl" ).arg( group ), m_url );
+    TomahawkSettings::instance()->setValue( QString( "%1/xspfetag" ).arg( group ), m_etag );
+    TomahawkSettings::instance()->setValue( QString( "%1/xspflastmodified" ).arg( group ), m_lastModified );
+    TomahawkSettings::instance()->setValue( QString( "%1/xspfhash" ).arg( group ), m_bodyHash );
 }
 
 void
 XspfUpdater::loadFromSettings( const QString& group )
 {
     m_url = TomahawkSettings::instance()->value( QString( "%1/xspfurl" ).arg( group ) ).toString();
+    m_etag = TomahawkSettings::instance()->value( QString( "%1/xspfetag" ).arg( group ) ).toString();
+    m_lastModified = TomahawkSettings::instance()->value( QString( "%1/xspflastmodified" ).arg( group ) ).toString();
+    m_bodyHash = TomahawkSettings::instance()->value( QString( "%1/xspfhash" ).arg( group ) ).toString();
 }
 
 void
 XspfUpdater::removeFromSettings( const QString& group ) const
 {
     TomahawkSettings::instance()->remove( QString( "%1/xspfurl" ).arg( group ) );
+    TomahawkSettings::instance()->remove( QString( "%1/xspfetag" ).arg( group ) );
+    TomahawkSettings::instance()->remove( QString( "%1/xspflastmodified" ).arg( group ) );
+    TomahawkSettings::instance()->remove( QString( "%1/xspfhash" ).arg( group ) );
 }
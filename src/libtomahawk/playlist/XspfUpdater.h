@@ -46,10 +46,17 @@ protected:
     virtual void removeFromSettings(const QString& group) const;
 
 private slots:
-    void playlistLoaded();
+    void playlistLoaded( const QList< Tomahawk::query_ptr >& newTracks );
 
 private:
+    QString settingsKey() const;
+
     QString m_url;
+
+    // validators of the last document we applied, so unchanged ones aren't fetched or parsed again
+    QString m_etag;
+    QString m_lastModified;
+    QString m_bodyHash;
 };
 
 }
@@ -34,6 +34,7 @@
 #include "treeitemdelegate.h"
 #include "treemodel.h"
 #include "viewmanager.h"
+#include "pipeline.h"
 #include "utils/logger.h"
 
 #define SCROLL_TIMEOUT 280
@@ -161,12 +162,51 @@ ArtistView::onViewChanged()
 }
 
 
+void
+ArtistView::resolveVisibleTracks()
+{
+    // walk the expanded rows on screen, and a screenful below them
+    const QModelIndex top = indexAt( viewport()->rect().topLeft() );
+    QModelIndexList rows;
+    int onScreen = 0, below = -1;
+    for ( QModelIndex idx = top; idx.isValid() && below != 0; idx = indexBelow( idx ) )
+    {
+        if ( below > 0 )
+            below--;
+        else if ( visualRect( idx ).top() > viewport()->rect().bottom() )
+            below = onScreen;
+        else
+            onScreen++;
+
+        rows << idx;
+    }
+
+    // and a screenful above, so scrolling back up finds them ready too
+    int above = onScreen;
+    for ( QModelIndex idx = indexAbove( top ); idx.isValid() && above > 0; idx = indexAbove( idx ), above-- )
+        rows << idx;
+
+    QList< query_ptr > visible;
+    foreach ( const QModelIndex& idx, rows )
+    {
+        TreeModelItem* item = m_model->itemFromIndex( m_proxyModel->mapToSource( idx ) );
+        if ( item && !item->query().isNull() && !item->query()->resolvingFinished() )
+            visible << item->query();
+    }
+
+    Pipeline::instance()->resolveVisible( visible, m_visibleQueries );
+    m_visibleQueries = visible;
+}
+
+
 void
 ArtistView::onScrollTimeout()
 {
     if ( m_timer.isActive() )
         m_timer.stop();
 
+    resolveVisibleTracks();
+
     QModelIndex left = indexAt( viewport()->rect().topLeft() );
     while ( left.isValid() && left.parent().isValid() )
         left = left.parent();
@@ -102,6 +102,8 @@ private slots:
     void onMenuTriggered( int action );
 
 private:
+    void resolveVisibleTracks();
+
     TreeHeader* m_header;
     OverlayWidget* m_overlay;
     TreeModel* m_model;
@@ -117,6 +119,8 @@ private:
     bool m_showModes;
     QTimer m_timer;
     mutable QString m_guid;
+
+    QList< Tomahawk::query_ptr > m_visibleQueries;
 };
 
 #endif // ARTISTVIEW_H
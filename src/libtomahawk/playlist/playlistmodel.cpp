@@ -248,7 +248,7 @@ PlaylistModel::insert( const QList< Tomahawk::plentry_ptr >& entries, int row )
 
     if ( !m_waitingForResolved.isEmpty() )
     {
-        Pipeline::instance()->resolve( queries );
+        Pipeline::instance()->resolve( queries, Pipeline::BackgroundPriority );
         emit loadingStarted();
     }
 
@@ -48,3 +48,15 @@ QueueProxyModelPlaylistInterface::siblingItem( int itemsAway )
 
     return res;
 }
+
+
+Tomahawk::result_ptr
+QueueProxyModelPlaylistInterface::peekNextItem()
+{
+    if ( m_proxyModel.isNull() )
+        return Tomahawk::result_ptr();
+
+    // the queue always plays its first playable item
+    m_proxyModel.data()->setCurrentIndex( QModelIndex() );
+    return TrackProxyModelPlaylistInterface::siblingItem( 1, true );
+}
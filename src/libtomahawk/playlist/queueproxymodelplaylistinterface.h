@@ -38,6 +38,7 @@ public:
     virtual ~QueueProxyModelPlaylistInterface();
 
     virtual Tomahawk::result_ptr siblingItem( int itemsAway );
+    virtual Tomahawk::result_ptr peekNextItem();
 };
 
 } //ns
@@ -537,13 +537,17 @@ TrackModel::onPlaybackStopped()
 void
 TrackModel::ensureResolved()
 {
+    QList< query_ptr > queries;
     for( int i = 0; i < rowCount( QModelIndex() ); i++ )
     {
         query_ptr query = itemFromIndex( index( i, 0, QModelIndex() ) )->query();
 
         if ( !query->resolvingFinished() )
-            Pipeline::instance()->resolve( query );
+            queries << query;
     }
+
+    // views showing this model bump the rows they display
+    Pipeline::instance()->resolve( queries, Pipeline::BackgroundPriority );
 }
 
 
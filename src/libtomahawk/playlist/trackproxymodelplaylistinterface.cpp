@@ -109,6 +109,17 @@ TrackProxyModelPlaylistInterface::hasNextItem()
 }
 
 
+Tomahawk::result_ptr
+TrackProxyModelPlaylistInterface::peekNextItem()
+{
+    // in shuffle mode the next item is picked randomly when we get there
+    if ( m_shuffled )
+        return Tomahawk::result_ptr();
+
+    return siblingItem( 1, true );
+}
+
+
 Tomahawk::result_ptr
 TrackProxyModelPlaylistInterface::siblingItem( int itemsAway, bool readOnly )
 {
@@ -47,6 +47,7 @@ public:
     virtual Tomahawk::result_ptr siblingItem( int itemsAway );
     virtual Tomahawk::result_ptr siblingItem( int itemsAway, bool readOnly );
     virtual bool hasNextItem();
+    virtual Tomahawk::result_ptr peekNextItem();
 
     virtual QString filter() const;
     virtual void setFilter( const QString& pattern );
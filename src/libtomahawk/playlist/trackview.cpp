@@ -24,6 +24,7 @@
 
 #include "trackheader.h"
 #include "viewmanager.h"
+#include "pipeline.h"
 #include "trackmodel.h"
 #include "trackproxymodel.h"
 #include "audio/audioengine.h"
@@ -36,6 +37,8 @@
 #include "artist.h"
 #include "album.h"
 
+#define SCROLL_TIMEOUT 280
+
 using namespace Tomahawk;
 
 
@@ -84,6 +87,11 @@ TrackView::TrackView( QWidget* parent )
     connect( this, SIGNAL( doubleClicked( QModelIndex ) ), SLOT( onItemActivated( QModelIndex ) ) );
     connect( this, SIGNAL( customContextMenuRequested( const QPoint& ) ), SLOT( onCustomContextMenu( const QPoint& ) ) );
     connect( m_contextMenu, SIGNAL( triggered( int ) ), SLOT( onMenuTriggered( int ) ) );
+
+    m_timer.setInterval( SCROLL_TIMEOUT );
+    connect( verticalScrollBar(), SIGNAL( rangeChanged( int, int ) ), SLOT( onViewChanged() ) );
+    connect( verticalScrollBar(), SIGNAL( valueChanged( int ) ), SLOT( onViewChanged() ) );
+    connect( &m_timer, SIGNAL( timeout() ), SLOT( onScrollTimeout() ) );
 }
 
 
@@ -110,6 +118,53 @@ TrackView::setProxyModel( TrackProxyModel* model )
     setItemDelegate( m_delegate );
 
     QTreeView::setModel( m_proxyModel );
+
+    connect( m_proxyModel, SIGNAL( rowsInserted( QModelIndex, int, int ) ), SLOT( onViewChanged() ) );
+    connect( m_proxyModel, SIGNAL( layoutChanged() ), SLOT( onViewChanged() ) );
+    connect( m_proxyModel, SIGNAL( modelReset() ), SLOT( onViewChanged() ) );
+}
+
+
+void
+TrackView::onViewChanged()
+{
+    if ( m_timer.isActive() )
+        m_timer.stop();
+
+    m_timer.start();
+}
+
+
+void
+TrackView::onScrollTimeout()
+{
+    if ( m_timer.isActive() )
+        m_timer.stop();
+
+    if ( !m_proxyModel || !m_proxyModel->sourceModel() )
+        return;
+
+    const int rows = m_proxyModel->rowCount( QModelIndex() );
+    const QModelIndex top = indexAt( viewport()->rect().topLeft() );
+    const QModelIndex bottom = indexAt( viewport()->rect().bottomLeft() );
+
+    // include a page above and below, so scrolling a bit finds them ready
+    int first = top.isValid() ? top.row() : 0;
+    int last = bottom.isValid() ? bottom.row() : rows - 1;
+    const int page = last - first + 1;
+    first = qMax( 0, first - page );
+    last = qMin( rows - 1, last + page );
+
+    QList< query_ptr > visible;
+    for ( int i = first; i <= last; i++ )
+    {
+        TrackModelItem* item = m_proxyModel->itemFromIndex( m_proxyModel->mapToSource( m_proxyModel->index( i, 0 ) ) );
+        if ( item && !item->query().isNull() && !item->query()->resolvingFinished() )
+            visible << item->query();
+    }
+
+    Pipeline::instance()->resolveVisible( visible, m_visibleQueries );
+    m_visibleQueries = visible;
 }
 
 
@@ -220,6 +275,7 @@ void
 TrackView::resizeEvent( QResizeEvent* event )
 {
     QTreeView::resizeEvent( event );
+    onViewChanged();
 
     int sortSection = m_header->sortIndicatorSection();
     Qt::SortOrder sortOrder = m_header->sortIndicatorOrder();
@@ -21,9 +21,11 @@
 
 #include <QtGui/QTreeView>
 #include <QtGui/QSortFilterProxyModel>
+#include <QtCore/QTimer>
 
 #include "contextmenu.h"
 #include "playlistitemdelegate.h"
+#include "typedefs.h"
 
 #include "dllmacro.h"
 
@@ -98,6 +100,9 @@ private slots:
 
     void onCustomContextMenu( const QPoint& pos );
 
+    void onViewChanged();
+    void onScrollTimeout();
+
 private:
     void updateHoverIndex( const QPoint& pos );
 
@@ -118,6 +123,9 @@ private:
     QModelIndex m_hoveredIndex;
     QModelIndex m_contextMenuIndex;
     Tomahawk::ContextMenu* m_contextMenu;
+
+    QTimer m_timer;
+    QList< Tomahawk::query_ptr > m_visibleQueries;
 };
 
 #endif // TRACKVIEW_H
@@ -19,6 +19,7 @@
 #include "treemodel.h"
 
 #include <QMimeData>
+#include <QSet>
 
 #include "source.h"
 #include "sourcelist.h"
@@ -26,9 +27,13 @@
 #include "database/databasecommand_allalbums.h"
 #include "database/databasecommand_alltracks.h"
 #include "database/database.h"
+#include "pipeline.h"
 #include "utils/tomahawkutils.h"
 #include "utils/logger.h"
 
+// above this many changed artists one reload is cheaper than a query per artist
+#define MAX_ARTIST_REFRESHES 50
+
 using namespace Tomahawk;
 
 
@@ -576,7 +581,8 @@ TreeModel::addAllCollections()
     QList<Tomahawk::source_ptr> sources = SourceList::instance()->sources();
     foreach ( const source_ptr& source, sources )
     {
-        connect( source->collection().data(), SIGNAL( changed() ), SLOT( onCollectionChanged() ), Qt::UniqueConnection );
+        connect( source->collection().data(), SIGNAL( artistsChanged( QList<Tomahawk::artist_ptr>, Tomahawk::ArtistAlbumIds ) ),
+                                                SLOT( onArtistsChanged( QList<Tomahawk::artist_ptr>, Tomahawk::ArtistAlbumIds ) ), Qt::UniqueConnection );
     }
 
     m_title = tr( "All Artists" );
@@ -687,7 +693,8 @@ TreeModel::addCollection( const collection_ptr& collection )
 
     Database::instance()->enqueue( QSharedPointer<DatabaseCommand>( cmd ) );
 
-    connect( collection.data(), SIGNAL( changed() ), SLOT( onCollectionChanged() ), Qt::UniqueConnection );
+    connect( collection.data(), SIGNAL( artistsChanged( QList<Tomahawk::artist_ptr>, Tomahawk::ArtistAlbumIds ) ),
+                                SLOT( onArtistsChanged( QList<Tomahawk::artist_ptr>, Tomahawk::ArtistAlbumIds ) ), Qt::UniqueConnection );
 
     if ( !collection->source()->avatar().isNull() )
         setIcon( collection->source()->avatar() );
@@ -727,26 +734,221 @@ TreeModel::addFilteredCollection( const collection_ptr& collection, unsigned int
 void
 TreeModel::onSourceAdded( const Tomahawk::source_ptr& source )
 {
-    connect( source->collection().data(), SIGNAL( changed() ), SLOT( onCollectionChanged() ), Qt::UniqueConnection );
+    connect( source->collection().data(), SIGNAL( artistsChanged( QList<Tomahawk::artist_ptr>, Tomahawk::ArtistAlbumIds ) ),
+                                            SLOT( onArtistsChanged( QList<Tomahawk::artist_ptr>, Tomahawk::ArtistAlbumIds ) ), Qt::UniqueConnection );
 }
 
 
 void
-TreeModel::onCollectionChanged()
+TreeModel::onArtistsChanged( const QList<Tomahawk::artist_ptr>& artists, const Tomahawk::ArtistAlbumIds& albumIds )
 {
-    clear();
+    if ( m_mode != DatabaseMode )
+        return;
 
-    if ( m_collection )
-        addCollection( m_collection );
-    else
-        addAllCollections();
+    if ( artists.count() > MAX_ARTIST_REFRESHES )
+    {
+        clear();
+
+        if ( m_collection )
+            addCollection( m_collection );
+        else
+            addAllCollections();
+        return;
+    }
+
+    // only re-query the artists which got files added or removed, the rest of the tree stays as it is
+    foreach ( const artist_ptr& artist, artists )
+    {
+        QList< QVariant > data;
+        data << artist->id();
+        foreach ( unsigned int albumId, albumIds.value( artist->id() ) )
+            data << albumId;
+
+        DatabaseCommand_AllAlbums* cmd = new DatabaseCommand_AllAlbums( m_collection, artist );
+        cmd->setData( QVariant( data ) );
+
+        connect( cmd, SIGNAL( albums( QList<Tomahawk::album_ptr>, QVariant ) ),
+                        SLOT( onArtistRefreshed( QList<Tomahawk::album_ptr>, QVariant ) ) );
+
+        Database::instance()->enqueue( QSharedPointer<DatabaseCommand>( cmd ) );
+    }
 }
 
 
 void
-TreeModel::onArtistsAdded( const QList<Tomahawk::artist_ptr>& artists )
+TreeModel::onArtistRefreshed( const QList<Tomahawk::album_ptr>& albums, const QVariant& data )
+{
+    QList< QVariant > ids = data.toList();
+    const unsigned int artistId = ids.takeFirst().toUInt();
+    TreeModelItem* parentItem = artistItem( artistId );
+
+    if ( albums.isEmpty() )
+    {
+        // the artist has no files left in this collection
+        if ( parentItem )
+        {
+            removeIndex( parentItem->index );
+            emit itemCountChanged( rowCount( QModelIndex() ) );
+        }
+        return;
+    }
+
+    if ( !parentItem )
+    {
+        QList<Tomahawk::artist_ptr> artists;
+        artists << albums.first()->artist();
+        onArtistsAdded( artists );
+        return;
+    }
+
+    // albums haven't been loaded yet, they get fetched when the artist is expanded
+    if ( !parentItem->fetchingMore || parentItem->children.isEmpty() )
+        return;
+
+    QSet<unsigned int> albumIds;
+    foreach ( const album_ptr& album, albums )
+        albumIds << album->id();
+
+    QSet<unsigned int> dirtyIds;
+    foreach ( const QVariant& id, ids )
+        dirtyIds << id.toUInt();
+
+    QSet<unsigned int> knownIds;
+    for ( int i = parentItem->children.count() - 1; i >= 0; i-- )
+    {
+        TreeModelItem* item = parentItem->children.at( i );
+        const unsigned int albumId = item->album()->id();
+
+        if ( !albumIds.contains( albumId ) )
+        {
+            removeIndex( item->index );
+            continue;
+        }
+
+        knownIds << albumId;
+        if ( !dirtyIds.contains( albumId ) || !item->fetchingMore || item->children.isEmpty() )
+            continue;
+
+        QList< QVariant > rows;
+        rows << artistId << albumId;
+
+        DatabaseCommand_AllTracks* cmd = new DatabaseCommand_AllTracks( m_collection );
+        cmd->setAlbum( item->album() );
+        cmd->setData( QVariant( rows ) );
+
+        connect( cmd, SIGNAL( tracks( QList<Tomahawk::query_ptr>, QVariant ) ),
+                        SLOT( onAlbumRefreshed( QList<Tomahawk::query_ptr>, QVariant ) ) );
+
+        Database::instance()->enqueue( QSharedPointer<DatabaseCommand>( cmd ) );
+    }
+
+    QList<Tomahawk::album_ptr> added;
+    foreach ( const album_ptr& album, albums )
+    {
+        if ( !knownIds.contains( album->id() ) )
+            added << album;
+    }
+
+    if ( !added.isEmpty() )
+        onAlbumsAdded( added, parentItem->index );
+}
+
+
+void
+TreeModel::onAlbumRefreshed( const QList<Tomahawk::query_ptr>& tracks, const QVariant& data )
+{
+    QList< QVariant > ids = data.toList();
+    TreeModelItem* parentItem = albumItem( ids.at( 0 ).toUInt(), ids.at( 1 ).toUInt() );
+    if ( !parentItem )
+        return;
+
+    QSet<QString> urls;
+    foreach ( const query_ptr& query, tracks )
+    {
+        if ( query->numResults() )
+            urls << query->results().first()->url();
+    }
+
+    QSet<QString> knownUrls;
+    for ( int i = parentItem->children.count() - 1; i >= 0; i-- )
+    {
+        TreeModelItem* item = parentItem->children.at( i );
+        if ( item->result().isNull() )
+            continue;
+
+        if ( urls.contains( item->result()->url() ) )
+            knownUrls << item->result()->url();
+        else
+            removeIndex( item->index );
+    }
+
+    QList<Tomahawk::query_ptr> added;
+    foreach ( const query_ptr& query, tracks )
+    {
+        if ( !query->numResults() || !knownUrls.contains( query->results().first()->url() ) )
+            added << query;
+    }
+
+    if ( !added.isEmpty() )
+        onTracksAdded( added, parentItem->index );
+}
+
+
+TreeModelItem*
+TreeModel::artistItem( unsigned int artistId ) const
+{
+    foreach ( TreeModelItem* item, m_rootItem->children )
+    {
+        if ( !item->artist().isNull() && item->artist()->id() == artistId )
+            return item;
+    }
+
+    return 0;
+}
+
+
+TreeModelItem*
+TreeModel::albumItem( unsigned int artistId, unsigned int albumId ) const
+{
+    TreeModelItem* parentItem = artistItem( artistId );
+    if ( !parentItem )
+        return 0;
+
+    foreach ( TreeModelItem* item, parentItem->children )
+    {
+        if ( !item->album().isNull() && item->album()->id() == albumId )
+            return item;
+    }
+
+    return 0;
+}
+
+
+void
+TreeModel::onArtistsAdded( const QList<Tomahawk::artist_ptr>& newArtists )
 {
     emit loadingFinished();
+
+    // a collection change may have added some of them while this list was loading,
+    // or two of them raced each other for the same new artist
+    QList<Tomahawk::artist_ptr> artists = newArtists;
+    if ( m_mode == DatabaseMode && !m_rootItem->children.isEmpty() )
+    {
+        QSet<unsigned int> known;
+        foreach ( TreeModelItem* item, m_rootItem->children )
+        {
+            if ( !item->artist().isNull() )
+                known << item->artist()->id();
+        }
+
+        artists.clear();
+        foreach ( const artist_ptr& artist, newArtists )
+        {
+            if ( !known.contains( artist->id() ) )
+                artists << artist;
+        }
+    }
+
     if ( !artists.count() )
     {
         emit itemCountChanged( rowCount( QModelIndex() ) );
@@ -929,11 +1131,14 @@ TreeModel::infoSystemInfo( Tomahawk::InfoSystem::InfoRequestData requestData, QV
 
                 foreach ( const QString& trackName, tracks )
                 {
-                    query_ptr query = Query::get( inputInfo[ "artist" ], trackName, inputInfo[ "album" ], uuid() );
+                    query_ptr query = Query::get( inputInfo[ "artist" ], trackName, inputInfo[ "album" ], uuid(), false );
                     query->setAlbumPos( trackNo++ );
                     ql << query;
                 }
 
+                // the view bumps whatever is on screen
+                Pipeline::instance()->resolve( ql, Pipeline::BackgroundPriority );
+
                 onTracksAdded( ql, idx );
             }
             else if ( m_receivedInfoData.count() == 2 /* FIXME */ )
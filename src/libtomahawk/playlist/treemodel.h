@@ -144,7 +144,7 @@ protected:
     void fetchMore( const QModelIndex& parent );
 
 private slots:
-    void onArtistsAdded( const QList<Tomahawk::artist_ptr>& artists );
+    void onArtistsAdded( const QList<Tomahawk::artist_ptr>& newArtists );
     void onAlbumsAdded( const QList<Tomahawk::album_ptr>& albums, const QModelIndex& index );
     void onAlbumsFound( const QList<Tomahawk::album_ptr>& albums, const QVariant& variant );
     void onTracksAdded( const QList<Tomahawk::query_ptr>& tracks, const QModelIndex& index );
@@ -158,9 +158,15 @@ private slots:
     void onDataChanged();
 
     void onSourceAdded( const Tomahawk::source_ptr& source );
-    void onCollectionChanged();
+
+    void onArtistsChanged( const QList<Tomahawk::artist_ptr>& artists, const Tomahawk::ArtistAlbumIds& albumIds );
+    void onArtistRefreshed( const QList<Tomahawk::album_ptr>& albums, const QVariant& data );
+    void onAlbumRefreshed( const QList<Tomahawk::query_ptr>& tracks, const QVariant& data );
 
 private:
+    TreeModelItem* artistItem( unsigned int artistId ) const;
+    TreeModelItem* albumItem( unsigned int artistId, unsigned int albumId ) const;
+
     QPersistentModelIndex m_currentIndex;
     TreeModelItem* m_rootItem;
     QString m_infoId;
@@ -90,6 +90,17 @@ TreeProxyModelPlaylistInterface::hasNextItem()
 }
 
 
+Tomahawk::result_ptr
+TreeProxyModelPlaylistInterface::peekNextItem()
+{
+    // in shuffle mode the next item is picked randomly when we get there
+    if ( m_shuffled )
+        return Tomahawk::result_ptr();
+
+    return siblingItem( 1, true );
+}
+
+
 Tomahawk::result_ptr
 TreeProxyModelPlaylistInterface::siblingItem( int itemsAway )
 {
@@ -44,6 +44,7 @@ public:
     virtual int trackCount() const;
 
     virtual bool hasNextItem();
+    virtual Tomahawk::result_ptr peekNextItem();
     virtual Tomahawk::result_ptr currentItem() const;
     virtual Tomahawk::result_ptr siblingItem( int direction );
     virtual Tomahawk::result_ptr siblingItem( int direction, bool readOnly );
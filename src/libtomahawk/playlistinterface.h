@@ -55,6 +55,8 @@ public:
     virtual Tomahawk::result_ptr previousItem();
     virtual bool hasNextItem() { return true; }
     virtual Tomahawk::result_ptr nextItem();
+    // Returns what nextItem() will most likely return, without advancing. Null if that can't be predicted
+    virtual Tomahawk::result_ptr peekNextItem() { return Tomahawk::result_ptr(); }
     virtual Tomahawk::result_ptr siblingItem( int itemsAway ) = 0;
 
     virtual PlaylistInterface::RepeatMode repeatMode() const = 0;
@@ -34,6 +34,7 @@
 #include "sourcelist.h"
 #include "audio/audioengine.h"
 
+#include "utils/interner.h"
 #include "utils/logger.h"
 
 using namespace Tomahawk;
@@ -62,7 +63,7 @@ Query::get( const QString& query, const QID& qid )
     q->setWeakRef( q.toWeakRef() );
 
     if ( !qid.isEmpty() )
-        Pipeline::instance()->resolve( q );
+        Pipeline::instance()->resolve( q, Pipeline::InteractivePriority );
 
     return q;
 }
@@ -134,10 +135,16 @@ Query::updateSortNames()
     }
     else
     {
-        m_artistSortname = DatabaseImpl::sortname( m_artist, true );
-        m_composerSortName = DatabaseImpl::sortname( m_composer, true );
-        m_albumSortname = DatabaseImpl::sortname( m_album );
-        m_trackSortname = DatabaseImpl::sortname( m_track );
+        // the same names show up in thousands of queries, only keep one copy of each
+        m_artist = TomahawkUtils::internString( m_artist );
+        m_composer = TomahawkUtils::internString( m_composer );
+        m_album = TomahawkUtils::internString( m_album );
+        m_track = TomahawkUtils::internString( m_track );
+
+        m_artistSortname = TomahawkUtils::internString( DatabaseImpl::sortname( m_artist, true ) );
+        m_composerSortName = TomahawkUtils::internString( DatabaseImpl::sortname( m_composer, true ) );
+        m_albumSortname = TomahawkUtils::internString( DatabaseImpl::sortname( m_album ) );
+        m_trackSortname = TomahawkUtils::internString( DatabaseImpl::sortname( m_track ) );
     }
 }
 
@@ -26,27 +26,23 @@
 #include "database/databasecommand_alltracks.h"
 #include "database/databasecommand_addfiles.h"
 
+#include "utils/interner.h"
 #include "utils/logger.h"
 
 using namespace Tomahawk;
 
-static QHash< QString, QWeakPointer< Result > > s_results;
-static QMutex s_mutex;
+static TomahawkUtils::WeakInternHash< QString, Result >* s_results = new TomahawkUtils::WeakInternHash< QString, Result >();
 
 
 Tomahawk::result_ptr
 Result::get( const QString& url )
 {
-    QMutexLocker lock( &s_mutex );
-    if ( s_results.contains( url ) )
-    {
-        return s_results.value( url );
-    }
-
-    result_ptr r = result_ptr( new Result( url ) );
-    s_results.insert( url, r );
+    result_ptr r = s_results->value( url );
+    if ( !r.isNull() )
+        return r;
 
-    return r;
+    // another thread may have beaten us to it
+    return s_results->insert( url, result_ptr( new Result( url ) ) );
 }
 
 
@@ -69,11 +65,7 @@ Result::Result( const QString& url )
 
 Result::~Result()
 {
-    QMutexLocker lock( &s_mutex );
-    if ( s_results.contains( m_url ) )
-    {
-        s_results.remove( m_url );
-    }
+    s_results->removeExpired( m_url );
 }
 
 
@@ -131,6 +131,9 @@ SourceList::add( const source_ptr& source )
     if ( source->id() > 0 )
         m_sources_id2name.insert( source->id(), source->userName() );
     connect( source.data(), SIGNAL( syncedWithDatabase() ), SLOT( sourceSynced() ) );
+    connect( source.data(), SIGNAL( syncedWithDatabase() ), SLOT( onSourceStateChanged() ) );
+    connect( source.data(), SIGNAL( online() ), SLOT( onSourceStateChanged() ) );
+    connect( source.data(), SIGNAL( offline() ), SLOT( onSourceStateChanged() ) );
 
     collection_ptr coll( new RemoteCollection( source ) );
     source->addCollection( coll );
@@ -219,6 +222,29 @@ SourceList::sourceSynced()
 }
 
 
+QSet<int>
+SourceList::onlineSourceIds() const
+{
+    QMutexLocker lock( &m_mut );
+    return m_onlineIds;
+}
+
+
+void
+SourceList::onSourceStateChanged()
+{
+    Source* src = qobject_cast< Source* >( sender() );
+    if ( !src || src->id() <= 0 )
+        return;
+
+    QMutexLocker lock( &m_mut );
+    if ( src->isOnline() )
+        m_onlineIds.insert( src->id() );
+    else
+        m_onlineIds.remove( src->id() );
+}
+
+
 unsigned int
 SourceList::count() const
 {
@@ -22,6 +22,7 @@
 #include <QObject>
 #include <QMutex>
 #include <QMap>
+#include <QSet>
 
 #include "typedefs.h"
 #include "source.h"
@@ -54,6 +55,9 @@ public:
     Tomahawk::source_ptr get( const QString& username, const QString& friendlyName = QString() );
     Tomahawk::source_ptr get( int id ) const;
 
+    /// ids of all remote sources that are currently online, safe to call from the database thread
+    QSet<int> onlineSourceIds() const;
+
 signals:
     void ready();
 
@@ -66,6 +70,7 @@ signals:
 private slots:
     void setSources( const QList<Tomahawk::source_ptr>& sources );
     void sourceSynced();
+    void onSourceStateChanged();
 
     void latchedOn( const Tomahawk::source_ptr& );
     void latchedOff( const Tomahawk::source_ptr& );
@@ -75,6 +80,7 @@ private:
 
     QMap< QString, Tomahawk::source_ptr > m_sources;
     QMap< int, QString > m_sources_id2name;
+    QSet< int > m_onlineIds;
 
     bool m_isReady;
     Tomahawk::source_ptr m_local;
@@ -303,6 +303,48 @@ TomahawkSettings::setHttpEnabled( bool enable )
 }
 
 
+uint
+TomahawkSettings::streamCacheSize() const
+{
+    return value( "network/streamcachesize", 500 ).toUInt();
+}
+
+
+void
+TomahawkSettings::setStreamCacheSize( uint megabytes )
+{
+    setValue( "network/streamcachesize", megabytes );
+}
+
+
+uint
+TomahawkSettings::uploadRateLimit() const
+{
+    return value( "network/uploadratelimit", 0 ).toUInt();
+}
+
+
+void
+TomahawkSettings::setUploadRateLimit( uint kbytesPerSec )
+{
+    setValue( "network/uploadratelimit", kbytesPerSec );
+}
+
+
+uint
+TomahawkSettings::peerUploadRateLimit() const
+{
+    return value( "network/peeruploadratelimit", 0 ).toUInt();
+}
+
+
+void
+TomahawkSettings::setPeerUploadRateLimit( uint kbytesPerSec )
+{
+    setValue( "network/peeruploadratelimit", kbytesPerSec );
+}
+
+
 bool
 TomahawkSettings::crashReporterEnabled() const
 {
@@ -120,6 +120,14 @@ public:
     bool httpEnabled() const; /// true by default
     void setHttpEnabled( bool enable );
 
+    uint streamCacheSize() const; /// in MB, 0 disables the stream cache
+    void setStreamCacheSize( uint megabytes );
+
+    uint uploadRateLimit() const; /// in KB/s for all streams together, 0 means unlimited
+    void setUploadRateLimit( uint kbytesPerSec );
+    uint peerUploadRateLimit() const; /// in KB/s for the streams to a single peer, 0 means unlimited
+    void setPeerUploadRateLimit( uint kbytesPerSec );
+
     bool crashReporterEnabled() const; /// true by default
     void setCrashReporterEnabled( bool enable );
 
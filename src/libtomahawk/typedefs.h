@@ -22,6 +22,8 @@
 #include <QSharedPointer>
 #include <QUuid>
 #include <QPair>
+#include <QHash>
+#include <QList>
 
 //template <typename T> class QSharedPointer;
 
@@ -54,6 +56,9 @@ namespace Tomahawk
     typedef QSharedPointer<DynamicControl> dyncontrol_ptr;
     typedef QSharedPointer<GeneratorInterface> geninterface_ptr;
 
+    // album ids per artist id
+    typedef QHash< unsigned int, QList<unsigned int> > ArtistAlbumIds;
+
     // let's keep these typesafe, they are different kinds of GUID:
     typedef QString QID; //query id
     typedef QString RID; //result id
@@ -0,0 +1,59 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Copyright 2010-2011, Christian Muehlhaeuser <muesli@tomahawk-player.org>
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "interner.h"
+
+#include <QSet>
+
+#define STRING_SHARDS 16
+// a full shard is dropped and starts over, strings handed out before stay valid
+#define MAX_STRINGS_PER_SHARD 4096
+
+namespace TomahawkUtils
+{
+
+struct StringShard
+{
+    QMutex mutex;
+    QSet< QString > strings;
+};
+
+static StringShard s_stringShards[ STRING_SHARDS ];
+
+
+QString
+internString( const QString& str )
+{
+    if ( str.isEmpty() )
+        return QString();
+
+    StringShard& shard = s_stringShards[ qHash( str ) % STRING_SHARDS ];
+    QMutexLocker lock( &shard.mutex );
+
+    QSet< QString >::const_iterator it = shard.strings.constFind( str );
+    if ( it != shard.strings.constEnd() )
+        return *it;
+
+    if ( shard.strings.count() >= MAX_STRINGS_PER_SHARD )
+        shard.strings.clear();
+
+    shard.strings.insert( str );
+    return str;
+}
+
+}
@@ -0,0 +1,95 @@
+/* === This file is part of Tomahawk Player - <http://tomahawk-player.org> ===
+ *
+ *   Copyright 2010-2011, Christian Muehlhaeuser <muesli@tomahawk-player.org>
+ *
+ *   Tomahawk is free software: you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, either version 3 of the License, or
+ *   (at your option) any later version.
+ *
+ *   Tomahawk is distributed in the hope that it will be useful,
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *   GNU General Public License for more details.
+ *
+ *   You should have received a copy of the GNU General Public License
+ *   along with Tomahawk. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef INTERNER_H
+#define INTERNER_H
+
+#include <QHash>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QString>
+
+#include "dllmacro.h"
+
+namespace TomahawkUtils
+{
+
+/**
+ * Weak, lock-striped lookup table for shared objects like artists and albums.
+ *
+ * Entries don't keep their objects alive, so an object goes away with its last
+ * user. The table is split into shards with a mutex each, so threads looking up
+ * different keys rarely wait for each other.
+ */
+template< typename Key, typename T, int Shards = 16 >
+class WeakInternHash
+{
+public:
+    QSharedPointer<T> value( const Key& key )
+    {
+        Shard& s = shard( key );
+        QMutexLocker lock( &s.mutex );
+        return s.hash.value( key ).toStrongRef();
+    }
+
+    // returns the object already stored for key if there is a live one, otherwise stores and returns obj
+    QSharedPointer<T> insert( const Key& key, const QSharedPointer<T>& obj )
+    {
+        Shard& s = shard( key );
+        QMutexLocker lock( &s.mutex );
+
+        QSharedPointer<T> existing = s.hash.value( key ).toStrongRef();
+        if ( !existing.isNull() )
+            return existing;
+
+        s.hash.insert( key, obj.toWeakRef() );
+        return obj;
+    }
+
+    // call from T's destructor, only drops the entry if nobody re-created it in the meantime
+    void removeExpired( const Key& key )
+    {
+        Shard& s = shard( key );
+        QMutexLocker lock( &s.mutex );
+
+        typename QHash< Key, QWeakPointer<T> >::iterator it = s.hash.find( key );
+        if ( it != s.hash.end() && it.value().isNull() )
+            s.hash.erase( it );
+    }
+
+private:
+    struct Shard
+    {
+        QMutex mutex;
+        QHash< Key, QWeakPointer<T> > hash;
+    };
+
+    Shard& shard( const Key& key ) { return m_shards[ qHash( key ) % Shards ]; }
+
+    Shard m_shards[ Shards ];
+};
+
+/**
+ * Returns a copy of str that shares its data with earlier copies of an equal
+ * string, so the same artist or album name is only stored once.
+ */
+DLLEXPORT QString internString( const QString& str );
+
+}
+
+#endif // INTERNER_H
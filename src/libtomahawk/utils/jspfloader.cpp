@@ -31,6 +31,7 @@
 
 #include "sourcelist.h"
 #include "playlist.h"
+#include "pipeline.h"
 
 using namespace Tomahawk;
 
@@ -95,6 +96,7 @@ void
 JSPFLoader::networkLoadFinished()
 {
     QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
+    reply->deleteLater();
     m_body = reply->readAll();
     gotBody();
 }
@@ -114,6 +116,7 @@ JSPFLoader::gotBody()
     QJson::Parser p;
     bool retOk;
     QVariantMap wrapper = p.parse( m_body, &retOk ).toMap();
+    m_body.clear();
 
     if ( !retOk )
     {
@@ -166,13 +169,15 @@ JSPFLoader::gotBody()
                 continue;
             }
 
-            query_ptr q = Tomahawk::Query::get( artist, track, album, uuid() );
+            query_ptr q = Tomahawk::Query::get( artist, track, album, uuid(), false );
             q->setDuration( duration.toInt() / 1000 );
             if( !url.isEmpty() )
                 q->setResultHint( url );
 
             m_entries << q;
         }
+
+        Pipeline::instance()->resolve( m_entries, Pipeline::BackgroundPriority );
     }
 
     if ( origTitle.isEmpty() && m_entries.isEmpty() )
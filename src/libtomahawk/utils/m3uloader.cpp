@@ -24,6 +24,7 @@
 #include "sourcelist.h"
 
 #include "playlist.h"
+#include "pipeline.h"
 #include "dropjob.h"
 
 #include <QFileInfo>
@@ -33,6 +34,9 @@
 #include <taglib/fileref.h>
 #include <taglib/tag.h>
 
+// tag reading is slow, so resolve what we have every so many tracks
+#define RESOLVE_BATCH_SIZE 500
+
 using namespace Tomahawk;
 
 
@@ -90,7 +94,7 @@ M3uLoader::getTags( const QFileInfo& info )
     else
     {
         qDebug() << Q_FUNC_INFO << artist << track << album;
-        Tomahawk::query_ptr q = Tomahawk::Query::get( artist, track, album, uuid(), !m_createNewPlaylist );
+        Tomahawk::query_ptr q = Tomahawk::Query::get( artist, track, album, uuid(), false );
         m_tracks << q;
     }
 }
@@ -109,6 +113,7 @@ M3uLoader::parseM3u( const QString& fileLink )
     }
 
     m_title = fileInfo.baseName();
+    int resolved = 0;
     while ( !file.atEnd() )
     {
          QByteArray line = file.readLine();
@@ -127,8 +132,17 @@ M3uLoader::parseM3u( const QString& fileLink )
              if ( tmpFile.exists() )
                 getTags( tmpFile );
          }
+
+         if ( m_tracks.count() - resolved >= RESOLVE_BATCH_SIZE )
+         {
+             Pipeline::instance()->resolve( m_tracks.mid( resolved ), Pipeline::BackgroundPriority );
+             resolved = m_tracks.count();
+         }
     }
 
+    if ( m_tracks.count() > resolved )
+        Pipeline::instance()->resolve( m_tracks.mid( resolved ), Pipeline::BackgroundPriority );
+
     if ( m_tracks.isEmpty() )
     {
         tDebug() << Q_FUNC_INFO << "Could not parse M3U!";
@@ -532,30 +532,41 @@ newerVersion( const QString& oldVersion, const QString& newVersion )
 }
 
 
+static QString
+mergeKey( const Tomahawk::query_ptr& query )
+{
+    return query->artist() + QChar( '\t' ) + query->track() + QChar( '\t' ) + query->album();
+}
+
+
 QList< Tomahawk::query_ptr >
-mergePlaylistChanges( const QList< Tomahawk::query_ptr >& orig, const QList< Tomahawk::query_ptr >& newTracks )
+mergePlaylistChanges( const QList< Tomahawk::query_ptr >& orig, const QList< Tomahawk::query_ptr >& newTracks, bool* changed )
 {
-    int sameCount = 0;
-    QList< Tomahawk::query_ptr > tosave = newTracks;
+    // index the old tracks once, duplicates are handed out in their original order
+    QHash< QString, QList< Tomahawk::query_ptr > > oldTracks;
+    foreach ( const Tomahawk::query_ptr& oldq, orig )
+        oldTracks[ mergeKey( oldq ) ] << oldq;
+
+    bool same = ( orig.size() == newTracks.size() );
+    QList< Tomahawk::query_ptr > tosave;
+    tosave.reserve( newTracks.size() );
     foreach ( const Tomahawk::query_ptr& newquery, newTracks )
     {
-        foreach ( const Tomahawk::query_ptr& oldq, orig )
-        {
-            if ( newquery->track() == oldq->track() &&
-                newquery->artist() == oldq->artist() &&
-                newquery->album() == oldq->album() )
-            {
-                sameCount++;
-                if ( tosave.contains( newquery ) )
-                    tosave.replace( tosave.indexOf( newquery ), oldq );
+        QHash< QString, QList< Tomahawk::query_ptr > >::iterator it = oldTracks.find( mergeKey( newquery ) );
+        if ( it != oldTracks.end() && !it.value().isEmpty() )
+            tosave << it.value().takeFirst();
+        else
+            tosave << newquery;
 
-                break;
-            }
-        }
+        if ( same && tosave.last() != orig.at( tosave.count() - 1 ) )
+            same = false;
     }
 
+    if ( changed )
+        *changed = !same;
+
     // No work to be done if all are the same
-    if ( orig.size() == newTracks.size() && sameCount == orig.size() )
+    if ( same )
         return orig;
 
     return tosave;
@@ -596,6 +607,20 @@ quint64 infosystemRequestId()
 }
 
 
+QUrl
+resolverUrl( const QString& url )
+{
+    // keep the query part of the url exactly as the resolver encoded it
+    const int query = url.indexOf( '?' );
+    if ( query < 0 )
+        return QUrl( url );
+
+    QUrl furl( url.left( query ) );
+    furl.setEncodedQuery( url.mid( query + 1 ).toLocal8Bit() );
+    return furl;
+}
+
+
 QString
 md5( const QByteArray& data )
 {
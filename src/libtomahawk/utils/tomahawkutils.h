@@ -24,6 +24,7 @@
 #include <QtCore/QThread>
 #include <QtNetwork/QNetworkProxy>
 #include <QtCore/QStringList>
+#include <QtCore/QUrl>
 #include <typedefs.h>
 
 
@@ -85,6 +86,7 @@ namespace TomahawkUtils
     DLLEXPORT QNetworkAccessManager* nam();
     DLLEXPORT void setNam( QNetworkAccessManager* nam, bool noMutexLocker = false );
     DLLEXPORT quint64 infosystemRequestId();
+    DLLEXPORT QUrl resolverUrl( const QString& url );
 
     DLLEXPORT QString md5( const QByteArray& data );
     DLLEXPORT bool removeDirectory( const QString& dir );
@@ -94,11 +96,10 @@ namespace TomahawkUtils
      * To avoid re-loading the whole playlist and re-resolving tracks that are the same in the old playlist,
      * it goes through the new playlist and adds only new tracks.
      *
-     * The new list of tracks is returned
-     *
-     * \return true if some changes were made, false if the new tracks are the same as the current tracks in \param orig
+     * The new list of tracks is returned. If \param changed is given, it is set to false when the
+     * new tracks are the same as the current tracks in \param orig, in the same order.
      */
-    DLLEXPORT QList< Tomahawk::query_ptr > mergePlaylistChanges( const QList< Tomahawk::query_ptr >& orig, const QList< Tomahawk::query_ptr >& newTracks );
+    DLLEXPORT QList< Tomahawk::query_ptr > mergePlaylistChanges( const QList< Tomahawk::query_ptr >& orig, const QList< Tomahawk::query_ptr >& newTracks, bool* changed = 0 );
 
     DLLEXPORT void crash();
 }
@@ -20,7 +20,6 @@
 
 #include "headlesscheck.h"
 
-#include <QDomDocument>
 
 #include "utils/tomahawkutils.h"
 #include "utils/logger.h"
@@ -30,6 +29,9 @@
 #include <XspfUpdater.h>
 #include <pipeline.h>
 
+// entries are handed to the playlist and the pipeline in chunks of this size
+#define ENTRY_CHUNK_SIZE 500
+
 using namespace Tomahawk;
 
 XSPFLoader::XSPFLoader( bool autoCreate, bool autoUpdate, QObject *parent )
@@ -38,6 +40,12 @@ XSPFLoader::XSPFLoader( bool autoCreate, bool autoUpdate, QObject *parent )
     , m_autoUpdate( autoUpdate )
     , m_autoResolve( true )
     , m_NS("http://xspf.org/ns/0/")
+    , m_hash( QCryptographicHash::Md5 )
+    , m_depth( 0 )
+    , m_inTrackList( false )
+    , m_inTrack( false )
+    , m_shownError( false )
+    , m_finished( false )
 {
     qRegisterMetaType< XSPFErrorCode >("XSPFErrorCode");
 }
@@ -61,15 +69,32 @@ XSPFLoader::entries() const
 }
 
 
+void
+XSPFLoader::setConditionalFetch( const QString& etag, const QString& lastModified, const QString& bodyHash )
+{
+    m_etag = etag;
+    m_lastModified = lastModified;
+    m_bodyHash = bodyHash;
+}
+
+
 void
 XSPFLoader::load( const QUrl& url )
 {
     QNetworkRequest request( url );
     m_url = url;
 
+    if ( !m_etag.isEmpty() )
+        request.setRawHeader( "If-None-Match", m_etag.toLatin1() );
+    if ( !m_lastModified.isEmpty() )
+        request.setRawHeader( "If-Modified-Since", m_lastModified.toLatin1() );
+
     Q_ASSERT( TomahawkUtils::nam() != 0 );
     QNetworkReply* reply = TomahawkUtils::nam()->get( request );
 
+    connect( reply, SIGNAL( readyRead() ),
+                      SLOT( networkDataReady() ) );
+
     connect( reply, SIGNAL( finished() ),
                       SLOT( networkLoadFinished() ) );
 
@@ -83,8 +108,10 @@ XSPFLoader::load( QFile& file )
 {
     if ( file.open( QFile::ReadOnly ) )
     {
-        m_body = file.readAll();
-        gotBody();
+        while ( !file.atEnd() )
+            gotData( file.read( 64 * 1024 ) );
+
+        finish();
     }
     else
     {
@@ -101,15 +128,51 @@ XSPFLoader::reportError()
 }
 
 
+void
+XSPFLoader::networkDataReady()
+{
+    QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
+    if ( reply->error() != QNetworkReply::NoError ||
+         reply->attribute( QNetworkRequest::HttpStatusCodeAttribute ).toInt() == 304 )
+        return;
+
+    gotData( reply->readAll() );
+}
+
+
 void
 XSPFLoader::networkLoadFinished()
 {
     QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
+    reply->deleteLater();
     if ( reply->error() != QNetworkReply::NoError )
         return;
 
-    m_body = reply->readAll();
-    gotBody();
+    if ( reply->attribute( QNetworkRequest::HttpStatusCodeAttribute ).toInt() == 304 )
+    {
+        emit notModified();
+        deleteLater();
+        return;
+    }
+
+    if ( reply->hasRawHeader( "ETag" ) )
+        m_etag = QString::fromLatin1( reply->rawHeader( "ETag" ) );
+    if ( reply->hasRawHeader( "Last-Modified" ) )
+        m_lastModified = QString::fromLatin1( reply->rawHeader( "Last-Modified" ) );
+
+    gotData( reply->readAll() );
+
+    // plenty of servers don't do conditional requests, so don't hand out the same document twice either
+    const QString hash = QString::fromLatin1( m_hash.result().toHex() );
+    if ( !m_bodyHash.isEmpty() && hash == m_bodyHash )
+    {
+        emit notModified();
+        deleteLater();
+        return;
+    }
+    m_bodyHash = hash;
+
+    finish();
 }
 
 
@@ -121,130 +184,204 @@ XSPFLoader::networkError( QNetworkReply::NetworkError /* error */ )
 
 
 void
-XSPFLoader::gotBody()
+XSPFLoader::gotData( const QByteArray& data )
 {
-    QDomDocument xmldoc;
-    bool namespaceProcessing = true;
-    xmldoc.setContent( m_body, namespaceProcessing );
-    QDomElement docElement( xmldoc.documentElement() );
+    if ( data.isEmpty() )
+        return;
 
-    QString origTitle;
-    QDomNodeList tracklist;
-    QDomElement n = docElement.firstChildElement();
-    for ( ; !n.isNull(); n = n.nextSiblingElement() )
-    {
-        if ( n.namespaceURI() == m_NS && n.localName() == "title" )
-        {
-            origTitle = n.text();
-        }
-        else if ( n.namespaceURI() == m_NS && n.localName() == "creator" )
-        {
-            m_creator = n.text();
-        }
-        else if ( n.namespaceURI() == m_NS && n.localName() == "info" )
-        {
-            m_info = n.text();
-        }
-        else if ( n.namespaceURI() == m_NS && n.localName() == "trackList" )
-        {
-            tracklist = n.childNodes();
-        }
-    }
+    m_hash.addData( data );
+    if ( m_reader.hasError() && m_reader.error() != QXmlStreamReader::PrematureEndOfDocumentError )
+        return;
+
+    m_reader.addData( data );
+    parse();
+}
 
-    m_title = origTitle;
-    if ( m_title.isEmpty() )
-        m_title = tr( "New Playlist" );
-    if ( !m_overrideTitle.isEmpty() )
-        m_title = m_overrideTitle;
 
-    bool shownError = false;
-    for ( unsigned int i = 0; i < tracklist.length(); i++ )
+void
+XSPFLoader::parse()
+{
+    // QXmlStreamReader reports PrematureEndOfDocumentError whenever it runs out of data,
+    // we just pick up where it left off with the next chunk
+    while ( !m_reader.atEnd() )
     {
-        QDomNode e = tracklist.at( i );
+        const QXmlStreamReader::TokenType token = m_reader.readNext();
 
-        QString artist, album, track, duration, annotation, url;
-        QDomElement n = e.firstChildElement();
-        for ( ; !n.isNull(); n = n.nextSiblingElement() )
+        if ( token == QXmlStreamReader::StartElement )
         {
-            if ( n.namespaceURI() == m_NS && n.localName() == "duration" )
-            {
-                duration = n.text();
-            }
-            else if ( n.namespaceURI() == m_NS && n.localName() == "annotation" )
+            m_depth++;
+            m_text.clear();
+
+            if ( m_reader.namespaceUri() != m_NS )
+                continue;
+
+            if ( m_depth == 2 && m_reader.name() == "trackList" )
             {
-                annotation = n.text();
+                m_inTrackList = true;
             }
-            else if ( n.namespaceURI() == m_NS && n.localName() == "creator" )
+            else if ( m_inTrackList && m_depth == 3 && m_reader.name() == "track" )
             {
-                artist = n.text();
+                m_inTrack = true;
+                m_trackFields.clear();
             }
-            else if ( n.namespaceURI() == m_NS && n.localName() == "album" )
+        }
+        else if ( token == QXmlStreamReader::Characters )
+        {
+            m_text += m_reader.text();
+        }
+        else if ( token == QXmlStreamReader::EndElement )
+        {
+            const int depth = m_depth--;
+            if ( m_reader.namespaceUri() != m_NS )
+                continue;
+
+            if ( m_inTrack && depth == 4 )
             {
-                album = n.text();
+                m_trackFields.insert( m_reader.name().toString(), m_text );
             }
-            else if ( n.namespaceURI() == m_NS && n.localName() == "title" )
+            else if ( m_inTrack && depth == 3 )
             {
-                track = n.text();
+                m_inTrack = false;
+
+                const QString artist = m_trackFields.value( "creator" );
+                const QString track = m_trackFields.value( "title" );
+                if ( artist.isEmpty() || track.isEmpty() )
+                {
+                    if ( !m_shownError )
+                    {
+                        emit error( InvalidTrackError );
+                        m_shownError = true;
+                    }
+                    continue;
+                }
+
+                query_ptr q = Tomahawk::Query::get( artist, track, m_trackFields.value( "album" ), uuid(), false );
+                q->setDuration( m_trackFields.value( "duration" ).toInt() / 1000 );
+                const QString url = m_trackFields.value( "url" );
+                if ( !url.isEmpty() )
+                    q->setResultHint( url );
+
+                m_chunk << q;
+                if ( m_chunk.count() >= ENTRY_CHUNK_SIZE )
+                    flushEntries();
             }
-            else if ( n.namespaceURI() == m_NS && n.localName() == "url" )
+            else if ( depth == 2 )
             {
-                url = n.text();
+                if ( m_reader.name() == "trackList" )
+                    m_inTrackList = false;
+                else if ( m_reader.name() == "title" )
+                    m_origTitle = m_text;
+                else if ( m_reader.name() == "creator" )
+                    m_creator = m_text;
+                else if ( m_reader.name() == "info" )
+                    m_info = m_text;
             }
         }
+    }
 
-        if ( artist.isEmpty() || track.isEmpty() )
-        {
-            if ( !shownError )
-            {
-                emit error( InvalidTrackError );
-                shownError = true;
-            }
-            continue;
-        }
+    if ( m_reader.hasError() && m_reader.error() != QXmlStreamReader::PrematureEndOfDocumentError )
+        tLog() << Q_FUNC_INFO << "Error parsing XSPF:" << m_reader.errorString() << "on line" << m_reader.lineNumber();
+}
 
-        query_ptr q = Tomahawk::Query::get( artist, track, album, uuid(), false );
-        q->setDuration( duration.toInt() / 1000 );
-        if ( !url.isEmpty() )
-            q->setResultHint( url );
 
-        m_entries << q;
-    }
+void
+XSPFLoader::flushEntries()
+{
+    // a titled playlist without any tracks still gets created once we're done
+    if ( m_chunk.isEmpty() && !( m_finished && m_autoCreate && m_playlist.isNull() ) )
+        return;
 
-    if ( m_autoResolve )
-    {
-        for ( int i = m_entries.size() - 1; i >= 0; i-- )
-            Pipeline::instance()->resolve( m_entries[ i ] );
-    }
+    const QList< query_ptr > chunk = m_chunk;
+    m_chunk.clear();
+    m_entries << chunk;
 
-    if ( origTitle.isEmpty() && m_entries.isEmpty() )
-    {
-        emit error( ParseError );
-        if ( m_autoCreate )
-            deleteLater();
+    if ( m_autoResolve && !chunk.isEmpty() )
+        Pipeline::instance()->resolve( chunk, Pipeline::BackgroundPriority );
+
+    if ( !m_autoCreate )
         return;
-    }
 
-    if ( m_autoCreate )
+    if ( m_playlist.isNull() )
     {
+        // the title precedes the trackList, so we know it by the time the first chunk is full
+        m_title = m_origTitle;
+        if ( m_title.isEmpty() )
+            m_title = tr( "New Playlist" );
+        if ( !m_overrideTitle.isEmpty() )
+            m_title = m_overrideTitle;
+
         m_playlist = Playlist::create( SourceList::instance()->getLocal(),
                                        uuid(),
                                        m_title,
                                        m_info,
                                        m_creator,
                                        false,
-                                       m_entries );
+                                       chunk );
+
+        connect( m_playlist.data(), SIGNAL( revisionLoaded( Tomahawk::PlaylistRevision ) ), SLOT( onRevisionLoaded() ) );
+        connect( m_playlist.data(), SIGNAL( deleted( Tomahawk::playlist_ptr ) ), SLOT( deleteLater() ) );
 
         // 10 minute default---for now, no way to change it
-        connect( m_playlist.data(), SIGNAL( revisionLoaded( Tomahawk::PlaylistRevision ) ), this, SLOT( playlistCreated() ) );
         new Tomahawk::XspfUpdater( m_playlist, 6000000, m_autoUpdate, m_url.toString() );
         emit ok( m_playlist );
     }
-    else{
+    else
+    {
+        m_pendingAppend << chunk;
+        appendPending();
+    }
+}
+
+
+void
+XSPFLoader::appendPending()
+{
+    // one revision in flight at a time: whatever gets parsed meanwhile goes into the next one
+    if ( m_pendingAppend.isEmpty() || m_playlist->busy() || m_playlist->currentrevision().isEmpty() )
+        return;
+
+    const QList< plentry_ptr > entries = m_playlist->entriesFromQueries( m_pendingAppend );
+    m_pendingAppend.clear();
+
+    m_playlist->createNewRevision( uuid(), m_playlist->currentrevision(), entries );
+}
+
+
+void
+XSPFLoader::onRevisionLoaded()
+{
+    appendPending();
+
+    if ( m_finished && m_pendingAppend.isEmpty() && !m_playlist->busy() )
+        deleteLater();
+}
+
+
+void
+XSPFLoader::finish()
+{
+    m_finished = true;
+
+    if ( m_origTitle.isEmpty() && m_entries.isEmpty() && m_chunk.isEmpty() )
+    {
+        emit error( ParseError );
+        if ( m_autoCreate )
+            deleteLater();
+        return;
+    }
+
+    flushEntries();
 
-        if( !m_entries.isEmpty() )
-            emit tracks( m_entries );
+    if ( m_autoCreate )
+    {
+        // stick around until the remaining chunks made it into the playlist
+        if ( m_playlist.isNull() || ( m_pendingAppend.isEmpty() && !m_playlist->busy() ) )
+            deleteLater();
+        return;
     }
 
-    deleteLater();
+    if ( !m_entries.isEmpty() )
+        emit tracks( m_entries );
 
+    deleteLater();
 }
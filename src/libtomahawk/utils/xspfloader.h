@@ -28,6 +28,8 @@
 #include <QFile>
 #include <QNetworkReply>
 #include <QNetworkRequest>
+#include <QXmlStreamReader>
+#include <QCryptographicHash>
 
 #include "playlist.h"
 #include "typedefs.h"
@@ -48,31 +50,56 @@ public:
     void setOverrideTitle( const QString& newTitle );
     void setAutoResolveTracks( bool autoResolve ) { m_autoResolve = autoResolve; }
 
+    /// Only fetch and parse the document if it changed since we saw these validators
+    void setConditionalFetch( const QString& etag, const QString& lastModified, const QString& bodyHash );
+    QString etag() const { return m_etag; }
+    QString lastModified() const { return m_lastModified; }
+    QString bodyHash() const { return m_bodyHash; }
+
 signals:
     void error( XSPFLoader::XSPFErrorCode error );
     void ok( const Tomahawk::playlist_ptr& );
     void track( const Tomahawk::query_ptr& track );
     void tracks( const QList< Tomahawk::query_ptr > tracks );
+    void notModified();
 
 public slots:
     void load( const QUrl& url );
     void load( QFile& file );
 
 private slots:
+    void networkDataReady();
     void networkLoadFinished();
     void networkError( QNetworkReply::NetworkError e );
 
+    void onRevisionLoaded();
+
 private:
     void reportError();
-    void gotBody();
+    void gotData( const QByteArray& data );
+    void parse();
+    void flushEntries();
+    void appendPending();
+    void finish();
 
     bool m_autoCreate, m_autoUpdate, m_autoResolve;
     QString m_NS,m_overrideTitle;
     QList< Tomahawk::query_ptr > m_entries;
-    QString m_title, m_info, m_creator;
+    QString m_title, m_origTitle, m_info, m_creator;
+
+    QXmlStreamReader m_reader;
+    QCryptographicHash m_hash;
+    int m_depth;
+    bool m_inTrackList, m_inTrack, m_shownError, m_finished;
+    QString m_text;
+    QHash< QString, QString > m_trackFields;
+
+    // parsed but not yet handed out, and handed out but not yet in the playlist
+    QList< Tomahawk::query_ptr > m_chunk;
+    QList< Tomahawk::query_ptr > m_pendingAppend;
 
     QUrl m_url;
-    QByteArray m_body;
+    QString m_etag, m_lastModified, m_bodyHash;
     Tomahawk::playlist_ptr m_playlist;
 };
 
@@ -20,6 +20,9 @@
 
 #include <QVBoxLayout>
 #include <QMetaMethod>
+#include <QHeaderView>
+#include <QScrollBar>
+#include <QTreeView>
 
 #include "audio/audioengine.h"
 #include "context/ContextWidget.h"
@@ -55,11 +58,32 @@
 
 #define FILTER_TIMEOUT 280
 
+// how many idle pages we keep around, and how many tracks they may hold in total
+#define MAX_CACHED_PAGES 12
+#define MAX_CACHED_TRACKS 25000
+#define MAX_PAGE_STATES 256
+
 using namespace Tomahawk;
 
 ViewManager* ViewManager::s_instance = 0;
 
 
+// drops the entry pointing at page, and any whose page is gone already
+template< typename K, typename V >
+static void
+removeView( QHash< K, QWeakPointer<V> >& views, ViewPage* page )
+{
+    typename QHash< K, QWeakPointer<V> >::iterator it = views.begin();
+    while ( it != views.end() )
+    {
+        if ( it.value().isNull() || static_cast< ViewPage* >( it.value().data() ) == page )
+            it = views.erase( it );
+        else
+            ++it;
+    }
+}
+
+
 ViewManager*
 ViewManager::instance()
 {
@@ -73,6 +97,7 @@ ViewManager::ViewManager( QObject* parent )
     , m_welcomeWidget( new WelcomeWidget() )
     , m_whatsHotWidget( new WhatsHotWidget() )
     , m_topLovedWidget( 0 )
+    , m_pageStates( MAX_PAGE_STATES )
     , m_currentMode( PlaylistInterface::Tree )
     , m_loaded( false )
 {
@@ -134,7 +159,7 @@ PlaylistView*
 ViewManager::createPageForPlaylist( const playlist_ptr& pl )
 {
     PlaylistView* view = new PlaylistView();
-    PlaylistModel* model = new PlaylistModel();
+    PlaylistModel* model = new PlaylistModel( view );
     view->setPlaylistModel( model );
     model->loadPlaylist( pl );
     view->setFrameShape( QFrame::NoFrame );
@@ -142,6 +167,7 @@ ViewManager::createPageForPlaylist( const playlist_ptr& pl )
     pl->resolve();
 
     m_playlistViews.insert( pl, view );
+    registerPage( view, "playlist/" + pl->guid() );
     return view;
 }
 
@@ -190,6 +216,7 @@ ViewManager::show( const Tomahawk::dynplaylist_ptr& playlist )
     if ( !m_dynamicWidgets.contains( playlist ) || m_dynamicWidgets.value( playlist ).isNull() )
     {
        m_dynamicWidgets[ playlist ] = new Tomahawk::DynamicWidget( playlist, m_stack );
+       registerPage( m_dynamicWidgets.value( playlist ).data(), "dynplaylist/" + playlist->guid() );
 
        playlist->resolve();
     }
@@ -215,6 +242,7 @@ ViewManager::show( const Tomahawk::artist_ptr& artist )
     {
         swidget = new ArtistInfoWidget( artist );
         m_artistViews.insert( artist, swidget );
+        registerPage( swidget, "artist/" + artist->name() );
     }
     else
     {
@@ -234,6 +262,7 @@ ViewManager::show( const Tomahawk::album_ptr& album, Tomahawk::ModelMode initial
     {
         swidget = new AlbumInfoWidget( album, initialMode );
         m_albumViews.insert( album, swidget );
+        registerPage( swidget, "album/" + album->artist()->name() + "/" + album->name() );
     }
     else
     {
@@ -250,6 +279,7 @@ ViewManager::show( const Tomahawk::collection_ptr& collection )
 {
     qDebug() << Q_FUNC_INFO << m_currentMode;
     m_currentCollection = collection;
+    const QString key = QString( "collection/%1/%2/%3" ).arg( collection->source()->id() ).arg( collection->name() ).arg( m_currentMode );
     ViewPage* shown = 0;
     if ( m_currentMode == PlaylistInterface::Flat )
     {
@@ -257,7 +287,7 @@ ViewManager::show( const Tomahawk::collection_ptr& collection )
         if ( !m_collectionViews.contains( collection ) || m_collectionViews.value( collection ).isNull() )
         {
             view = new CollectionView();
-            CollectionFlatModel* model = new CollectionFlatModel();
+            CollectionFlatModel* model = new CollectionFlatModel( view );
             view->setTrackModel( model );
             view->setFrameShape( QFrame::NoFrame );
             view->setAttribute( Qt::WA_MacShowFocusRect, 0 );
@@ -265,6 +295,7 @@ ViewManager::show( const Tomahawk::collection_ptr& collection )
             model->addCollection( collection );
 
             m_collectionViews.insert( collection, view );
+            registerPage( view, key );
         }
         else
         {
@@ -281,7 +312,7 @@ ViewManager::show( const Tomahawk::collection_ptr& collection )
         if ( !m_treeViews.contains( collection ) || m_treeViews.value( collection ).isNull() )
         {
             view = new ArtistView();
-            TreeModel* model = new TreeModel();
+            TreeModel* model = new TreeModel( view );
             view->setTreeModel( model );
             view->setFrameShape( QFrame::NoFrame );
             view->setAttribute( Qt::WA_MacShowFocusRect, 0 );
@@ -289,6 +320,7 @@ ViewManager::show( const Tomahawk::collection_ptr& collection )
             model->addCollection( collection );
 
             m_treeViews.insert( collection, view );
+            registerPage( view, key );
         }
         else
         {
@@ -312,6 +344,7 @@ ViewManager::show( const Tomahawk::collection_ptr& collection )
             amodel->addCollection( collection );
 
             m_collectionAlbumViews.insert( collection, aview );
+            registerPage( aview, key );
         }
         else
         {
@@ -336,6 +369,7 @@ ViewManager::show( const Tomahawk::source_ptr& source )
     {
         swidget = new SourceInfoWidget( source );
         m_sourceViews.insert( source, swidget );
+        registerPage( swidget, QString( "source/%1" ).arg( source->id() ) );
     }
     else
     {
@@ -489,6 +523,7 @@ ViewManager::historyBack()
     qDebug() << "Showing page after moving backwards in history:" << newPage->widget()->metaObject()->className();
     setPage( newPage, false );
 
+    forgetPage( oldPage );
     delete oldPage;
 }
 
@@ -503,6 +538,7 @@ ViewManager::removeFromHistory ( ViewPage* p )
     else
     {
         m_pageHistory.removeAll( p );
+        forgetPage( p );
         delete p;
     }
 
@@ -601,6 +637,157 @@ ViewManager::setPage( ViewPage* page, bool trackHistory )
     m_stack->setCurrentWidget( page->widget() );
 
     updateView();
+    evictPages();
+}
+
+
+void
+ViewManager::registerPage( ViewPage* page, const QString& key )
+{
+    if ( !page )
+        return;
+
+    m_pageKeys.insert( page, key );
+
+    PageState* state = m_pageStates.take( key );
+    if ( !state )
+        return;
+
+    if ( page->playlistInterface() && !state->filter.isEmpty() )
+        page->playlistInterface()->setFilter( state->filter );
+
+    QTreeView* tree = qobject_cast< QTreeView* >( page->widget() );
+    if ( tree && tree->isSortingEnabled() && state->sortColumn >= 0 )
+        tree->sortByColumn( state->sortColumn, state->sortOrder );
+
+    // the model fills up asynchronously, so wait until we can actually scroll that far
+    QAbstractScrollArea* area = qobject_cast< QAbstractScrollArea* >( page->widget() );
+    if ( area && state->scrollValue > 0 )
+    {
+        QScrollBar* bar = area->verticalScrollBar();
+        bar->setProperty( "restoreValue", state->scrollValue );
+        connect( bar, SIGNAL( rangeChanged( int, int ) ), SLOT( onScrollRangeChanged( int, int ) ) );
+    }
+
+    delete state;
+}
+
+
+void
+ViewManager::onScrollRangeChanged( int min, int max )
+{
+    Q_UNUSED( min );
+    QScrollBar* bar = qobject_cast< QScrollBar* >( sender() );
+    if ( !bar )
+        return;
+
+    const int value = bar->property( "restoreValue" ).toInt();
+    if ( max < value )
+        return;
+
+    bar->setValue( value );
+    disconnect( bar, SIGNAL( rangeChanged( int, int ) ), this, SLOT( onScrollRangeChanged( int, int ) ) );
+}
+
+
+void
+ViewManager::savePageState( ViewPage* page )
+{
+    if ( !m_pageKeys.contains( page ) )
+        return;
+
+    PageState* state = new PageState;
+    state->filter = page->playlistInterface() ? page->playlistInterface()->filter() : QString();
+    state->scrollValue = 0;
+    state->sortColumn = -1;
+    state->sortOrder = Qt::AscendingOrder;
+
+    if ( QAbstractScrollArea* area = qobject_cast< QAbstractScrollArea* >( page->widget() ) )
+        state->scrollValue = area->verticalScrollBar()->value();
+
+    QTreeView* tree = qobject_cast< QTreeView* >( page->widget() );
+    if ( tree && tree->isSortingEnabled() )
+    {
+        state->sortColumn = tree->header()->sortIndicatorSection();
+        state->sortOrder = tree->header()->sortIndicatorOrder();
+    }
+
+    m_pageStates.insert( m_pageKeys.value( page ), state );
+}
+
+
+void
+ViewManager::forgetPage( ViewPage* page )
+{
+    // the keys would otherwise keep their playlists, collections etc. alive
+    m_pageKeys.remove( page );
+    removeView( m_dynamicWidgets, page );
+    removeView( m_collectionViews, page );
+    removeView( m_treeViews, page );
+    removeView( m_collectionAlbumViews, page );
+    removeView( m_artistViews, page );
+    removeView( m_albumViews, page );
+    removeView( m_playlistViews, page );
+    removeView( m_sourceViews, page );
+}
+
+
+bool
+ViewManager::isEvictable( ViewPage* page ) const
+{
+    // only pages we created ourselves can be rebuilt on demand
+    if ( !m_pageKeys.contains( page ) || page == currentPage() )
+        return false;
+
+    playlistinterface_ptr pi = page->playlistInterface();
+    if ( pi.isNull() )
+        return true;
+
+    const playlistinterface_ptr playing = AudioEngine::instance()->currentTrackPlaylist();
+    return !( pi == AudioEngine::instance()->playlist() || pi == playing ||
+              ( !playing.isNull() && pi->hasChildInterface( playing ) ) );
+}
+
+
+void
+ViewManager::evictPages()
+{
+    int pages = 0;
+    unsigned int tracks = 0;
+
+    // the history is ordered by last use, so everything past our budget is the least recently used
+    QList< ViewPage* > victims;
+    foreach ( ViewPage* page, m_pageHistory )
+    {
+        if ( !isEvictable( page ) )
+            continue;
+
+        const unsigned int count = page->playlistInterface() ? page->playlistInterface()->unfilteredTrackCount() : 0;
+        if ( pages == 0 || ( pages < MAX_CACHED_PAGES && tracks + count <= MAX_CACHED_TRACKS ) )
+        {
+            pages++;
+            tracks += count;
+        }
+        else
+            victims << page;
+    }
+
+    foreach ( ViewPage* page, victims )
+    {
+        tDebug() << "Evicting idle view page:" << page->title();
+        savePageState( page );
+
+        QWidget* widget = page->widget();
+        disconnect( widget, 0, this, 0 );
+
+        // going back skips evicted pages, they're rebuilt when shown again from the sidebar
+        m_pageHistory.removeAll( page );
+        forgetPage( page );
+        m_stack->removeWidget( widget );
+
+        // the page owns its model, so this frees the tracks as well
+        delete page;
+    }
 }
 
 
@@ -758,6 +945,8 @@ ViewManager::onWidgetDestroyed( QWidget* widget )
         if ( page->widget() != widget )
             continue;
 
+        m_pageKeys.remove( page );
+
         if ( !playlistForInterface( page->playlistInterface() ).isNull() )
         {
             m_playlistViews.remove( playlistForInterface( page->playlistInterface() ) );
@@ -21,6 +21,7 @@
 
 #include <QObject>
 #include <QHash>
+#include <QCache>
 #include <QStackedWidget>
 
 #include "artist.h"
@@ -177,9 +178,24 @@ private slots:
     void autoUpdateChanged( int );
 
     void onWidgetDestroyed( QWidget* widget );
+    void onScrollRangeChanged( int min, int max );
 
 private:
+    /// What we remember about an evicted page, so it can be rebuilt the way it was left
+    struct PageState
+    {
+        QString filter;
+        int scrollValue;
+        int sortColumn;
+        Qt::SortOrder sortOrder;
+    };
+
     void setPage( Tomahawk::ViewPage* page, bool trackHistory = true );
+    void registerPage( Tomahawk::ViewPage* page, const QString& key );
+    void savePageState( Tomahawk::ViewPage* page );
+    void forgetPage( Tomahawk::ViewPage* page );
+    bool isEvictable( Tomahawk::ViewPage* page ) const;
+    void evictPages();
     void updateView();
     void unlinkPlaylist();
     void saveCurrentPlaylistSettings();
@@ -217,6 +233,10 @@ private:
 
     QList<Tomahawk::ViewPage*> m_pageHistory;
 
+    // pages we know how to rebuild, and the state of the ones we evicted
+    QHash< Tomahawk::ViewPage*, QString > m_pageKeys;
+    QCache< QString, PageState > m_pageStates;
+
     Tomahawk::collection_ptr m_currentCollection;
     int m_currentMode;
 
@@ -24,6 +24,7 @@
 #include <QPainter>
 #include <QStandardItemModel>
 #include <QStandardItem>
+#include <QTimer>
 
 #include "viewmanager.h"
 #include "sourcelist.h"
@@ -44,6 +45,9 @@
 #define HISTORY_PLAYLIST_ITEMS 10
 #define HISTORY_RESOLVING_TIMEOUT 2500
 
+// spread prefetching out, it's not urgent
+#define CHART_PREFETCH_INTERVAL 2000
+
 using namespace Tomahawk;
 
 static QString s_whatsHotIdentifier = QString( "WhatsHotWidget" );
@@ -54,6 +58,7 @@ WhatsHotWidget::WhatsHotWidget( QWidget* parent )
     , ui( new Ui::WhatsHotWidget )
     , m_sortedProxy( 0 )
     , m_workerThread( 0 )
+    , m_timer( 0 )
 {
     ui->setupUi( this );
 
@@ -98,6 +103,10 @@ WhatsHotWidget::WhatsHotWidget( QWidget* parent )
     m_workerThread = new QThread( this );
     m_workerThread->start();
 
+    m_timer = new QTimer( this );
+    m_timer->setInterval( CHART_PREFETCH_INTERVAL );
+    connect( m_timer, SIGNAL( timeout() ), SLOT( prefetchNextChart() ) );
+
     connect( Tomahawk::InfoSystem::InfoSystem::instance(),
              SIGNAL( info( Tomahawk::InfoSystem::InfoRequestData, QVariant ) ),
              SLOT( infoSystemInfo( Tomahawk::InfoSystem::InfoRequestData, QVariant ) ) );
@@ -228,6 +237,8 @@ WhatsHotWidget::infoSystemInfo( Tomahawk::InfoSystem::InfoRequestData requestDat
             m_sortedProxy->setSourceModel( m_crumbModelLeft );
             m_sortedProxy->sort( 0, Qt::AscendingOrder );
             ui->breadCrumbLeft->setModel( m_sortedProxy );
+
+            prefetchDefaultCharts();
             break;
         }
 
@@ -333,6 +344,7 @@ WhatsHotWidget::leftCrumbIndexChanged( QModelIndex index )
 
 
     const QString chartId = item->data( Breadcrumb::ChartIdRole ).toString();
+    m_queueItemToShow = chartId;
 
     if ( m_artistModels.contains( chartId ) )
     {
@@ -346,19 +358,27 @@ WhatsHotWidget::leftCrumbIndexChanged( QModelIndex index )
     }
     else if ( m_trackModels.contains( chartId ) )
     {
+        if ( m_unresolvedTracks.contains( chartId ) )
+            Pipeline::instance()->resolve( m_unresolvedTracks.take( chartId ), Pipeline::BackgroundPriority );
+
         setLeftViewTracks( m_trackModels[ chartId ] );
         return;
     }
 
     if ( m_queuedFetches.contains( chartId ) )
-    {
         return;
-    }
 
+    /// Remember to lower the source!
+    requestChart( chartId, index.data().toString().toLower() );
+}
+
+
+void
+WhatsHotWidget::requestChart( const QString& chartId, const QString& source )
+{
     Tomahawk::InfoSystem::InfoStringHash criteria;
     criteria.insert( "chart_id", chartId );
-    /// Remember to lower the source!
-    criteria.insert( "chart_source",  index.data().toString().toLower() );
+    criteria.insert( "chart_source", source );
 
     Tomahawk::InfoSystem::InfoRequestData requestData;
     QVariantMap customData;
@@ -374,7 +394,60 @@ WhatsHotWidget::leftCrumbIndexChanged( QModelIndex index )
     Tomahawk::InfoSystem::InfoSystem::instance()->getInfo( requestData );
 
     m_queuedFetches.insert( chartId );
-    m_queueItemToShow = chartId;
+}
+
+
+void
+WhatsHotWidget::prefetchDefaultCharts()
+{
+    m_prefetchQueue.clear();
+
+    QStandardItem* rootItem = m_crumbModelLeft->invisibleRootItem();
+    for ( int i = 0; i < rootItem->rowCount(); i++ )
+    {
+        QStandardItem* source = rootItem->child( i, 0 );
+
+        // follow the defaults down to the chart itself, like the breadcrumb does
+        QStandardItem* cur = source;
+        while ( cur->rowCount() > 0 )
+        {
+            QStandardItem* next = cur->child( 0, 0 );
+            for ( int k = 0; k < cur->rowCount(); k++ )
+            {
+                if ( cur->child( k, 0 )->data( Breadcrumb::DefaultRole ).toBool() )
+                {
+                    next = cur->child( k, 0 );
+                    break;
+                }
+            }
+            cur = next;
+        }
+
+        if ( cur->data( Breadcrumb::ChartIdRole ).isValid() )
+            m_prefetchQueue << qMakePair( cur->data( Breadcrumb::ChartIdRole ).toString(), source->text().toLower() );
+    }
+
+    if ( !m_prefetchQueue.isEmpty() )
+        m_timer->start();
+}
+
+
+void
+WhatsHotWidget::prefetchNextChart()
+{
+    while ( !m_prefetchQueue.isEmpty() )
+    {
+        QPair< QString, QString > chart = m_prefetchQueue.takeFirst();
+        if ( m_queuedFetches.contains( chart.first ) || m_artistModels.contains( chart.first ) ||
+             m_albumModels.contains( chart.first ) || m_trackModels.contains( chart.first ) )
+            continue;
+
+        tDebug( LOGVERBOSE ) << "WhatsHot: prefetching chart" << chart.first << "from" << chart.second;
+        requestChart( chart.first, chart.second );
+        return;
+    }
+
+    m_timer->stop();
 }
 
 
@@ -498,7 +571,12 @@ WhatsHotWidget::chartTracksLoaded( ChartDataLoader* loader, const QList< query_p
 
     if ( m_trackModels.contains( chartId ) )
     {
-        Pipeline::instance()->resolve( tracks );
+        // prefetched charts nobody looked at yet don't need to keep the resolvers busy
+        if ( m_queueItemToShow == chartId )
+            Pipeline::instance()->resolve( tracks, Pipeline::BackgroundPriority );
+        else
+            m_unresolvedTracks[ chartId ] = tracks;
+
         m_trackModels[ chartId ]->append( tracks );
     }
 
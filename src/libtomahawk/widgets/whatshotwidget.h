@@ -93,11 +93,16 @@ private slots:
     void chartAlbumsLoaded( Tomahawk::ChartDataLoader*, const QList< Tomahawk::album_ptr >& );
     void chartTracksLoaded( Tomahawk::ChartDataLoader*, const QList< Tomahawk::query_ptr >& );
 
+    void prefetchNextChart();
+
 private:
     void setLeftViewArtists( TreeModel* artistModel );
     void setLeftViewAlbums( AlbumModel* albumModel );
     void setLeftViewTracks( PlaylistModel* trackModel );
 
+    void requestChart( const QString& chartId, const QString& source );
+    // warm up the default chart of every source, so switching sources doesn't wait on the network
+    void prefetchDefaultCharts();
 
     QStandardItem* parseNode( QStandardItem* parentItem, const QString &label, const QVariant &data );
     Ui::WhatsHotWidget *ui;
@@ -119,6 +124,11 @@ private:
     QSet< QString > m_queuedFetches;
     QTimer* m_timer;
 
+    // chart id, source
+    QList< QPair< QString, QString > > m_prefetchQueue;
+    // tracks of prefetched charts, resolved once they're shown
+    QHash< QString, QList< Tomahawk::query_ptr > > m_unresolvedTracks;
+
     friend class Tomahawk::ChartsPlaylistInterface;
 };
 
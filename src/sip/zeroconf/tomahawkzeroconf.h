@@ -21,7 +21,13 @@
 
 #define ZCONF_PORT 50210
 
+// how long we trust a resolved advert before looking its sender up again
+#define ZCONF_NODE_TTL 30 * 60 * 1000
+
 #include <QList>
+#include <QHash>
+#include <QSet>
+#include <QDateTime>
 #include <QHostAddress>
 #include <QHostInfo>
 #include <QNetworkProxy>
@@ -112,43 +118,80 @@ signals:
 private slots:
     void readPacket()
     {
-        if ( !m_sock.hasPendingDatagrams() )
-            return;
+        while ( m_sock.hasPendingDatagrams() )
+        {
+            QByteArray datagram;
+            datagram.resize( m_sock.pendingDatagramSize() );
+            QHostAddress sender;
+            quint16 senderPort;
+            m_sock.readDatagram( datagram.data(), datagram.size(), &sender, &senderPort );
 
-        QByteArray datagram;
-        datagram.resize( m_sock.pendingDatagramSize() );
-        QHostAddress sender;
-        quint16 senderPort;
-        m_sock.readDatagram( datagram.data(), datagram.size(), &sender, &senderPort );
-        qDebug() << "DATAGRAM RCVD" << QString::fromAscii( datagram ) << sender;
+            // only process msgs originating on the LAN:
+            if ( !datagram.startsWith( "TOMAHAWKADVERT:" ) ||
+                 !Servent::isIPWhitelisted( sender ) )
+                continue;
 
-        // only process msgs originating on the LAN:
-        if ( datagram.startsWith( "TOMAHAWKADVERT:" ) &&
-            Servent::isIPWhitelisted( sender ) )
-        {
             QStringList parts = QString::fromAscii( datagram ).split( ':' );
             if ( parts.length() == 3 )
             {
                 bool ok;
                 int port = parts.at(1).toInt( &ok );
-                if(ok && Database::instance()->dbid() != parts.at( 2 ) )
-                {
-                    qDebug() << "ADVERT received:" << sender << port;
-                    Node *n = new Node( sender.toString(), parts.at( 2 ), port );
-                    connect( n,    SIGNAL( tomahawkHostFound( QString, int, QString, QString ) ),
-                             this, SIGNAL( tomahawkHostFound( QString, int, QString, QString ) ) );
-                    n->resolve();
-                }
+                if ( ok && Database::instance()->dbid() != parts.at( 2 ) )
+                    advertReceived( sender.toString(), port, parts.at( 2 ) );
             }
         }
+    }
 
-        if ( m_sock.hasPendingDatagrams() )
-            QTimer::singleShot( 0, this, SLOT( readPacket() ) );
+    void hostResolved( const QString& ip, int port, const QString& name, const QString& nid )
+    {
+        m_resolving.remove( nid );
+
+        KnownNode& node = m_nodes[ nid ];
+        node.ip = ip;
+        node.port = port;
+        node.name = name;
+        node.resolved = QDateTime::currentMSecsSinceEpoch();
+
+        emit tomahawkHostFound( ip, port, name, nid );
     }
 
 private:
+    void advertReceived( const QString& ip, int port, const QString& nid )
+    {
+        // every peer re-advertises, only look each of them up once in a while
+        if ( m_resolving.contains( nid ) )
+            return;
+
+        QHash< QString, KnownNode >::const_iterator it = m_nodes.constFind( nid );
+        if ( it != m_nodes.constEnd() && it->ip == ip && it->port == port &&
+             QDateTime::currentMSecsSinceEpoch() - it->resolved < ZCONF_NODE_TTL )
+        {
+            emit tomahawkHostFound( ip, port, it->name, nid );
+            return;
+        }
+
+        qDebug() << "ADVERT received:" << ip << port;
+        m_resolving.insert( nid );
+
+        Node *n = new Node( ip, nid, port );
+        connect( n,    SIGNAL( tomahawkHostFound( QString, int, QString, QString ) ),
+                 this, SLOT( hostResolved( QString, int, QString, QString ) ) );
+        n->resolve();
+    }
+
+    struct KnownNode
+    {
+        QString ip;
+        int port;
+        QString name;
+        qint64 resolved;
+    };
+
     QUdpSocket m_sock;
     int m_port;
+
+    QHash< QString, KnownNode > m_nodes;
+    QSet< QString > m_resolving;
 };
 
 #endif
@@ -25,6 +25,13 @@
 #include "tomahawksettings.h"
 #include "utils/logger.h"
 
+// re-advertise quickly at first in case a broadcast got lost, then back off
+#define ADVERT_MIN_INTERVAL 5 * 1000
+#define ADVERT_MAX_INTERVAL 10 * 60 * 1000
+
+// don't start another connection to a peer while the last attempt may still be running
+#define CONNECT_RETRY_INTERVAL 60 * 1000
+
 
 SipPlugin*
 ZeroconfFactory::createPlugin( const QString& pluginId )
@@ -41,7 +48,7 @@ ZeroconfPlugin::ZeroconfPlugin ( const QString& pluginId )
     , m_cachedNodes()
 {
     qDebug() << Q_FUNC_INFO;
-    m_advertisementTimer.setInterval( 60000 );
+    m_advertisementTimer.setInterval( ADVERT_MIN_INTERVAL );
     m_advertisementTimer.setSingleShot( false );
     connect( &m_advertisementTimer, SIGNAL( timeout() ), this, SLOT( advertise() ) );
 }
@@ -92,13 +99,10 @@ ZeroconfPlugin::connectPlugin( bool /*startup*/ )
     m_state = Connected;
 
     foreach( const QStringList& nodeSet, m_cachedNodes )
-    {
-        if ( !Servent::instance()->connectedToSession( nodeSet[3] ) )
-            Servent::instance()->connectToPeer( nodeSet[0], nodeSet[1].toInt(), "whitelist", nodeSet[2], nodeSet[3] );
-    }
+        connectToNode( nodeSet[0], nodeSet[1].toInt(), nodeSet[2], nodeSet[3] );
     m_cachedNodes.clear();
 
-    m_advertisementTimer.start();
+    m_advertisementTimer.start( ADVERT_MIN_INTERVAL );
 
     return true;
 }
@@ -108,6 +112,7 @@ ZeroconfPlugin::disconnectPlugin()
 {
     m_advertisementTimer.stop();
     m_state = Disconnected;
+    m_connectAttempts.clear();
 
     delete m_zeroconf;
     m_zeroconf = 0;
@@ -127,6 +132,9 @@ void
 ZeroconfPlugin::advertise()
 {
     m_zeroconf->advertise();
+
+    if ( m_advertisementTimer.isActive() )
+        m_advertisementTimer.setInterval( qMin( m_advertisementTimer.interval() * 2, ADVERT_MAX_INTERVAL ) );
 }
 
 
@@ -136,21 +144,35 @@ ZeroconfPlugin::lanHostFound( const QString& host, int port, const QString& name
     if ( sender() != m_zeroconf )
         return;
 
-    qDebug() << "Found LAN host:" << host << port << nodeid;
-
     if ( m_state != Connected )
     {
         qDebug() << "Not online, so not connecting.";
         QStringList nodeSet;
         nodeSet << host << QString::number( port ) << name << nodeid;
-        m_cachedNodes.append( nodeSet );
+        m_cachedNodes.insert( nodeid, nodeSet );
         return;
     }
 
-    if ( !Servent::instance()->connectedToSession( nodeid ) )
-        Servent::instance()->connectToPeer( host, port, "whitelist", name, nodeid );
-    else
-        qDebug() << "Already connected to" << host;
+    connectToNode( host, port, name, nodeid );
+}
+
+
+void
+ZeroconfPlugin::connectToNode( const QString& host, int port, const QString& name, const QString& nodeid )
+{
+    if ( Servent::instance()->connectedToSession( nodeid ) )
+    {
+        m_connectAttempts.remove( nodeid );
+        return;
+    }
+
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    if ( now - m_connectAttempts.value( nodeid, 0 ) < CONNECT_RETRY_INTERVAL )
+        return;
+
+    qDebug() << "Found LAN host:" << host << port << nodeid;
+    m_connectAttempts.insert( nodeid, now );
+    Servent::instance()->connectToPeer( host, port, "whitelist", name, nodeid );
 }
 
 
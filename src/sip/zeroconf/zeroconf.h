@@ -81,9 +81,13 @@ private slots:
     void lanHostFound( const QString& host, int port, const QString& name, const QString& nodeid );
 
 private:
+    // skips peers we're connected to or just tried to connect to
+    void connectToNode( const QString& host, int port, const QString& name, const QString& nodeid );
+
     TomahawkZeroconf* m_zeroconf;
     ConnectionState m_state;
-    QVector<QStringList> m_cachedNodes;
+    QHash< QString, QStringList > m_cachedNodes;
+    QHash< QString, qint64 > m_connectAttempts;
     QTimer m_advertisementTimer;
 };
 
@@ -19,6 +19,7 @@
 #include "api_v1.h"
 
 #include <QHash>
+#include <QLocale>
 
 #include "utils/logger.h"
 
@@ -27,11 +28,28 @@
 #include "database/databasecommand_addclientauth.h"
 #include "database/databasecommand_clientauthvalid.h"
 #include "network/servent.h"
+#include "network/rangeiodevice.h"
 #include "pipeline.h"
+#include "query.h"
+
+// how long a poll_results request waits for something to happen, in seconds
+#define POLL_TIMEOUT 25
+#define POLL_TIMEOUT_MAX 60
+// most queries a resolve_batch or qids a poll_results request may carry
+#define BATCH_SIZE_MAX 100
 
 using namespace Tomahawk;
 
 
+Api_v1::Api_v1( QxtAbstractWebSessionManager* sm, QObject* parent )
+    : QxtWebSlotService( sm, parent )
+    , m_storedEvent( 0 )
+{
+    m_pollTimer.setInterval( 1000 );
+    connect( &m_pollTimer, SIGNAL( timeout() ), SLOT( expirePolls() ) );
+}
+
+
 void
 Api_v1::auth_1( QxtWebRequestEvent* event, QString arg )
 {
@@ -155,7 +173,9 @@ Api_v1::api( QxtWebRequestEvent* event )
 
         if( method == "stat" )        return stat( event );
         if( method == "resolve" )     return resolve( event );
+        if( method == "resolve_batch" ) return resolve_batch( event );
         if( method == "get_results" ) return get_results( event );
+        if( method == "poll_results" ) return poll_results( event );
     }
 
     send404( event );
@@ -183,15 +203,152 @@ Api_v1::sid( QxtWebRequestEvent* event, QString unused )
         return send404( event ); // 503?
     }
 
+    if ( iodev->isSequential() || rp->size() <= 0 )
+    {
+        // remote streams can't seek, just pass them through
+        QxtWebPageEvent* e = new QxtWebPageEvent( event->sessionID, event->requestID, iodev );
+        e->streaming = iodev->isSequential();
+        e->contentType = rp->mimetype().toAscii();
+        if( rp->size() > 0 )
+            e->headers.insert( "Content-Length", QString::number( rp->size() ) );
+        postEvent( e );
+        return;
+    }
+
+    const qint64 size = rp->size();
+    const QDateTime mtime = QDateTime::fromTime_t( rp->modificationTime() );
+    const QString etag = QString( "\"%1-%2\"" ).arg( size ).arg( rp->modificationTime() );
+    const QString lastModified = httpDate( mtime );
+
+    const QString ifNoneMatch = headerValue( event, "If-None-Match" );
+    const QString ifModifiedSince = headerValue( event, "If-Modified-Since" );
+    if ( ( !ifNoneMatch.isEmpty() && ( ifNoneMatch == etag || ifNoneMatch == "*" ) ) ||
+         ( ifNoneMatch.isEmpty() && !ifModifiedSince.isEmpty() && ifModifiedSince == lastModified ) )
+    {
+        QxtWebPageEvent* e = new QxtWebPageEvent( event->sessionID, event->requestID, QByteArray() );
+        e->status = 304;
+        e->statusMessage = "Not Modified";
+        e->headers.insert( "ETag", etag );
+        e->headers.insert( "Last-Modified", lastModified );
+        postEvent( e );
+        return;
+    }
+
+    qint64 start = 0, end = size - 1;
+    bool partial = false;
+    const QString range = headerValue( event, "Range" );
+    // If-Range with a stale validator means the client wants the whole file again
+    const QString ifRange = headerValue( event, "If-Range" );
+    if ( !range.isEmpty() && ( ifRange.isEmpty() || ifRange == etag || ifRange == lastModified ) )
+    {
+        if ( !parseRange( range, size, start, end ) )
+        {
+            QxtWebPageEvent* e = new QxtWebPageEvent( event->sessionID, event->requestID, QByteArray() );
+            e->status = 416;
+            e->statusMessage = "Requested Range Not Satisfiable";
+            e->headers.insert( "Content-Range", QString( "bytes */%1" ).arg( size ) );
+            postEvent( e );
+            return;
+        }
+
+        partial = ( start > 0 || end < size - 1 );
+    }
+
+    const qint64 length = end - start + 1;
+    if ( partial )
+    {
+        // serve the requested slice straight from the (unbuffered) file
+        QSharedPointer<QIODevice> rangedev( new RangeIODevice( iodev, start, length ) );
+        if ( !rangedev->open( QIODevice::ReadOnly ) )
+            return send404( event );
+
+        iodev = rangedev;
+    }
+
     QxtWebPageEvent* e = new QxtWebPageEvent( event->sessionID, event->requestID, iodev );
-    e->streaming = iodev->isSequential();
+    e->streaming = false;
+    e->chunked = false;
     e->contentType = rp->mimetype().toAscii();
-    if( rp->size() > 0 )
-        e->headers.insert( "Content-Length", QString::number( rp->size() ) );
+    e->headers.insert( "Accept-Ranges", "bytes" );
+    e->headers.insert( "ETag", etag );
+    e->headers.insert( "Last-Modified", lastModified );
+    e->headers.insert( "Content-Length", QString::number( length ) );
+    if ( partial )
+    {
+        e->status = 206;
+        e->statusMessage = "Partial Content";
+        e->headers.insert( "Content-Range", QString( "bytes %1-%2/%3" ).arg( start ).arg( end ).arg( size ) );
+    }
     postEvent( e );
 }
 
 
+QString
+Api_v1::headerValue( QxtWebRequestEvent* event, const QString& name )
+{
+    // Qxt keeps header names as the client sent them
+    foreach ( const QString& key, event->headers.keys() )
+    {
+        if ( key.compare( name, Qt::CaseInsensitive ) == 0 )
+            return event->headers.value( key ).trimmed();
+    }
+
+    return QString();
+}
+
+
+QString
+Api_v1::httpDate( const QDateTime& dt )
+{
+    return QLocale::c().toString( dt.toUTC(), "ddd, dd MMM yyyy hh:mm:ss" ) + " GMT";
+}
+
+
+bool
+Api_v1::parseRange( const QString& header, qint64 size, qint64& start, qint64& end )
+{
+    // only a single "bytes=" range is supported, multipart responses are not
+    if ( !header.startsWith( "bytes=" ) || header.contains( ',' ) )
+        return false;
+
+    const QString spec = header.mid( 6 ).trimmed();
+    const int dash = spec.indexOf( '-' );
+    if ( dash < 0 )
+        return false;
+
+    bool ok = true;
+    const QString first = spec.left( dash ).trimmed();
+    const QString last = spec.mid( dash + 1 ).trimmed();
+    if ( first.isEmpty() )
+    {
+        // suffix range: the last N bytes
+        const qint64 suffix = last.toLongLong( &ok );
+        if ( !ok || suffix <= 0 )
+            return false;
+
+        start = qMax( Q_INT64_C( 0 ), size - suffix );
+        end = size - 1;
+        return true;
+    }
+
+    start = first.toLongLong( &ok );
+    if ( !ok || start < 0 || start >= size )
+        return false;
+
+    end = size - 1;
+    if ( !last.isEmpty() )
+    {
+        end = last.toLongLong( &ok );
+        if ( !ok || end < start )
+            return false;
+
+        end = qMin( end, size - 1 );
+    }
+
+    return true;
+}
+
+
 void
 Api_v1::send404( QxtWebRequestEvent* event )
 {
@@ -203,6 +360,17 @@ Api_v1::send404( QxtWebRequestEvent* event )
 }
 
 
+void
+Api_v1::send400( QxtWebRequestEvent* event, const QString& reason )
+{
+    qDebug() << "400" << event->url.toString() << reason;
+    QxtWebPageEvent* wpe = new QxtWebPageEvent( event->sessionID, event->requestID, "<h1>Bad Request</h1>" );
+    wpe->status = 400;
+    wpe->statusMessage = reason.toAscii();
+    postEvent( wpe );
+}
+
+
 void
 Api_v1::stat( QxtWebRequestEvent* event )
 {
@@ -267,6 +435,57 @@ Api_v1::resolve( QxtWebRequestEvent* event )
 }
 
 
+void
+Api_v1::resolve_batch( QxtWebRequestEvent* event )
+{
+    QByteArray json;
+    if ( event->url.hasQueryItem( "queries" ) )
+        json = QUrl::fromPercentEncoding( event->url.encodedQueryItemValue( "queries" ) ).toUtf8();
+    else if ( !event->content.isNull() )
+        json = event->content->readAll();
+
+    bool ok;
+    QJson::Parser parser;
+    const QVariantList queries = parser.parse( json, &ok ).toList();
+    if ( !ok || queries.isEmpty() )
+    {
+        qDebug() << "Malformed HTTP resolve_batch request";
+        send404( event );
+        return;
+    }
+    if ( queries.count() > BATCH_SIZE_MAX )
+    {
+        send400( event, "too many queries" );
+        return;
+    }
+
+    // qids are ours to hand out, clients could otherwise take over each
+    // other's queries. They come back in the order of the queries, with
+    // null for the ones missing artist or track
+    QList< query_ptr > qrys;
+    QVariantList qids;
+    foreach ( const QVariant& v, queries )
+    {
+        const QVariantMap m = v.toMap();
+        if ( m.value( "artist" ).toString().isEmpty() || m.value( "track" ).toString().isEmpty() )
+        {
+            qids << QVariant();
+            continue;
+        }
+
+        const QString qid = uuid();
+        qrys << Query::get( m.value( "artist" ).toString(), m.value( "track" ).toString(), m.value( "album" ).toString(), qid, false );
+        qids << qid;
+    }
+
+    Pipeline::instance()->resolve( qrys, true, true );
+
+    QVariantMap r;
+    r.insert( "qids", qids );
+    sendJSON( r, event );
+}
+
+
 void
 Api_v1::staticdata( QxtWebRequestEvent* event, const QString& str )
 {
@@ -299,11 +518,123 @@ Api_v1::get_results( QxtWebRequestEvent* event )
         return;
     }
 
-    QVariantMap r;
-    r.insert( "qid", qry->id() );
+    QVariantMap r = queryVariant( qry );
     r.insert( "poll_interval", 1300 );
     r.insert( "refresh_interval", 1000 );
     r.insert( "poll_limit", 14 );
+
+    sendJSON( r, event );
+}
+
+
+void
+Api_v1::poll_results( QxtWebRequestEvent* event )
+{
+    if ( !event->url.hasQueryItem( "qids" ) )
+    {
+        qDebug() << "Malformed HTTP poll_results request";
+        send404( event );
+        return;
+    }
+
+    const QStringList qids = event->url.queryItemValue( "qids" ).split( ",", QString::SkipEmptyParts );
+    if ( qids.count() > BATCH_SIZE_MAX )
+    {
+        send400( event, "too many qids" );
+        return;
+    }
+
+    int timeout = POLL_TIMEOUT;
+    if ( event->url.hasQueryItem( "timeout" ) )
+        timeout = qBound( 0, event->url.queryItemValue( "timeout" ).toInt(), POLL_TIMEOUT_MAX );
+
+    const QVariantList ready = pollResults( qids );
+    if ( !ready.isEmpty() || timeout == 0 )
+    {
+        QVariantMap r;
+        r.insert( "queries", ready );
+        sendJSON( r, event );
+        return;
+    }
+
+    // nothing to tell yet, answer as soon as the pipeline reports something
+    foreach ( const QString& qid, qids )
+    {
+        query_ptr qry = Pipeline::instance()->query( qid );
+        if ( qry.isNull() )
+            continue;
+
+        connect( qry.data(), SIGNAL( resultsAdded( QList<Tomahawk::result_ptr> ) ), SLOT( onQueryChanged() ), Qt::UniqueConnection );
+        connect( qry.data(), SIGNAL( resolvingFinished( bool ) ), SLOT( onQueryChanged() ), Qt::UniqueConnection );
+    }
+
+    PendingPoll poll;
+    poll.sessionID = event->sessionID;
+    poll.requestID = event->requestID;
+    poll.url = event->url;
+    poll.qids = qids;
+    poll.deadline = QDateTime::currentDateTime().addSecs( timeout );
+    m_polls << poll;
+
+    if ( !m_pollTimer.isActive() )
+        m_pollTimer.start();
+}
+
+
+void
+Api_v1::onQueryChanged()
+{
+    Query* qry = qobject_cast< Query* >( sender() );
+    if ( !qry )
+        return;
+
+    query_ptr qp = Pipeline::instance()->query( qry->id() );
+    if ( qp.isNull() )
+        return;
+
+    // the polls waiting on this query hadn't anything to report before, so
+    // this query is all that changed for them
+    QVariantMap r;
+    for ( int i = m_polls.count() - 1; i >= 0; i-- )
+    {
+        if ( !m_polls.at( i ).qids.contains( qry->id() ) )
+            continue;
+
+        if ( r.isEmpty() )
+            r.insert( "queries", QVariantList() << queryVariant( qp ) );
+
+        const PendingPoll poll = m_polls.takeAt( i );
+        sendJSON( r, poll.sessionID, poll.requestID, poll.url );
+    }
+}
+
+
+void
+Api_v1::expirePolls()
+{
+    const QDateTime now = QDateTime::currentDateTime();
+    for ( int i = m_polls.count() - 1; i >= 0; i-- )
+    {
+        if ( m_polls.at( i ).deadline > now )
+            continue;
+
+        const PendingPoll poll = m_polls.takeAt( i );
+
+        QVariantMap r;
+        r.insert( "queries", QVariantList() );
+        sendJSON( r, poll.sessionID, poll.requestID, poll.url );
+    }
+
+    if ( m_polls.isEmpty() )
+        m_pollTimer.stop();
+}
+
+
+QVariantMap
+Api_v1::queryVariant( const query_ptr& qry ) const
+{
+    QVariantMap r;
+    r.insert( "qid", qry->id() );
     r.insert( "solved", qry->playable() );
     r.insert( "query", qry->toVariant() );
 
@@ -314,21 +645,47 @@ Api_v1::get_results( QxtWebRequestEvent* event )
     }
     r.insert( "results", res );
 
-    sendJSON( r, event );
+    return r;
+}
+
+
+// the queries that have results or are done resolving
+QVariantList
+Api_v1::pollResults( const QStringList& qids ) const
+{
+    QVariantList list;
+    foreach ( const QString& qid, qids )
+    {
+        query_ptr qry = Pipeline::instance()->query( qid );
+        if ( qry.isNull() )
+            continue;
+
+        if ( !qry->results().isEmpty() || qry->resolvingFinished() )
+            list << queryVariant( qry );
+    }
+
+    return list;
 }
 
 
 void
 Api_v1::sendJSON( const QVariantMap& m, QxtWebRequestEvent* event )
+{
+    sendJSON( m, event->sessionID, event->requestID, event->url );
+}
+
+
+void
+Api_v1::sendJSON( const QVariantMap& m, int sessionID, int requestID, const QUrl& url )
 {
     QJson::Serializer ser;
     QByteArray ctype;
     QByteArray body = ser.serialize( m );
 
-    if( event->url.hasQueryItem("jsonp") && !event->url.queryItemValue( "jsonp" ).isEmpty() )
+    if( url.hasQueryItem("jsonp") && !url.queryItemValue( "jsonp" ).isEmpty() )
     {
         ctype = "text/javascript; charset=utf-8";
-        body.prepend( QString("%1( ").arg( event->url.queryItemValue( "jsonp" ) ).toAscii() );
+        body.prepend( QString("%1( ").arg( url.queryItemValue( "jsonp" ) ).toAscii() );
         body.append( " );" );
     }
     else
@@ -336,11 +693,11 @@ Api_v1::sendJSON( const QVariantMap& m, QxtWebRequestEvent* event )
         ctype = "appplication/json; charset=utf-8";
     }
 
-    QxtWebPageEvent * e = new QxtWebPageEvent( event->sessionID, event->requestID, body );
+    QxtWebPageEvent * e = new QxtWebPageEvent( sessionID, requestID, body );
     e->contentType = ctype;
     e->headers.insert( "Content-Length", QString::number( body.length() ) );
     postEvent( e );
-    qDebug() << "JSON response" << event->url.toString() << body;
+    qDebug() << "JSON response" << url.toString() << body;
 }
 
 
@@ -34,6 +34,10 @@
 #include <QFile>
 #include <QSharedPointer>
 #include <QStringList>
+#include <QDateTime>
+#include <QTimer>
+
+#include "typedefs.h"
 
 class Api_v1 : public QxtWebSlotService
 {
@@ -41,10 +45,7 @@ Q_OBJECT
 
 public:
 
-    Api_v1( QxtAbstractWebSessionManager* sm, QObject* parent = 0 )
-        : QxtWebSlotService( sm, parent )
-    {
-    }
+    Api_v1( QxtAbstractWebSessionManager* sm, QObject* parent = 0 );
 
 public slots:
     // authenticating uses /auth_1
@@ -58,11 +59,18 @@ public slots:
     // request for stream: /sid/<id>
     void sid( QxtWebRequestEvent* event, QString unused = QString() );
     void send404( QxtWebRequestEvent* event );
+    void send400( QxtWebRequestEvent* event, const QString& reason );
     void stat( QxtWebRequestEvent* event );
     void statResult( const QString& clientToken, const QString& name, bool valid );
     void resolve( QxtWebRequestEvent* event );
+    // many queries at once: queries=[{"artist":..,"track":..,"album":..}, ...], also as POST body.
+    // answers with qids=[<qid>|null, ...] in the same order
+    void resolve_batch( QxtWebRequestEvent* event );
     void staticdata( QxtWebRequestEvent* event,const QString& );
     void get_results( QxtWebRequestEvent* event );
+    // long-poll: answers once any of qids=<qid>,<qid>,.. has results or is done, or after timeout=<secs>.
+    // timeout=0 answers right away
+    void poll_results( QxtWebRequestEvent* event );
     void sendJSON( const QVariantMap& m, QxtWebRequestEvent* event );
 
     // load an html template from a file, replace args from map
@@ -71,8 +79,32 @@ public slots:
 
     void index( QxtWebRequestEvent* event );
 
+private slots:
+    void onQueryChanged();
+    void expirePolls();
+
 private:
+    struct PendingPoll
+    {
+        int sessionID;
+        int requestID;
+        QUrl url;
+        QStringList qids;
+        QDateTime deadline;
+    };
+
+    static QString headerValue( QxtWebRequestEvent* event, const QString& name );
+    static QString httpDate( const QDateTime& dt );
+    static bool parseRange( const QString& header, qint64 size, qint64& start, qint64& end );
+
+    QVariantMap queryVariant( const Tomahawk::query_ptr& qry ) const;
+    QVariantList pollResults( const QStringList& qids ) const;
+    void sendJSON( const QVariantMap& m, int sessionID, int requestID, const QUrl& url );
+
     QxtWebRequestEvent* m_storedEvent;
+
+    QList< PendingPoll > m_polls;
+    QTimer m_pollTimer;
 };
 
 #endif